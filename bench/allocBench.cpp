@@ -0,0 +1,93 @@
+// Heap allocations made by TransactionManager per million operations.
+// Replaces the global operator new with a counting one and runs the default
+// workloads with output turned off, so only the engine's own allocations
+// are counted.
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <streambuf>
+#include <vector>
+
+#include "options.hpp"
+#include "output.hpp"
+#include "topology.hpp"
+#include "transactionManager.hpp"
+#include "workload.hpp"
+
+using namespace std;
+
+namespace {
+
+atomic<long long> allocations{0};
+
+class NullBuffer : public streambuf {
+   protected:
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char *, streamsize n) override { return n; }
+};
+
+vector<WorkloadSpec> scenarios() {
+    vector<WorkloadSpec> suite;
+    WorkloadSpec base;
+    base.variables = 200;
+
+    WorkloadSpec spec = base;
+    spec.name = "uniform";
+    suite.push_back(spec);
+
+    spec = base;
+    spec.name = "write-heavy";
+    spec.readRatio = 0.3;
+    suite.push_back(spec);
+
+    spec = base;
+    spec.name = "skewed";
+    spec.zipfTheta = 0.99;
+    suite.push_back(spec);
+
+    spec = base;
+    spec.name = "failures";
+    spec.failEvery = 1000;
+    suite.push_back(spec);
+    return suite;
+}
+
+}  // namespace
+
+void *operator new(size_t size) {
+    allocations.fetch_add(1, memory_order_relaxed);
+    if (void *p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+int main() {
+    Options options;
+    NullBuffer nullBuffer;
+    output().setMode(OutputMode::QUIET);
+    cout << left << setw(14) << "workload" << setw(12) << "operations"
+         << "allocations per 1M operations" << endl;
+    for (const auto &spec : scenarios()) {
+        Topology topology(spec.sites, spec.variables, spec.replicas);
+        auto ops = generateWorkload(spec);
+        size_t numOps = ops.size();
+
+        auto *coutBuffer = cout.rdbuf(&nullBuffer);
+        long long before = allocations.load();
+        {
+            TransactionManager tm(move(ops), topology, options);
+            tm.simulate();
+        }
+        long long made = allocations.load() - before;
+        cout.rdbuf(coutBuffer);
+        cout << setw(14) << spec.name << setw(12) << numOps
+             << made * 1000000 / static_cast<long long>(numOps) << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,104 @@
+// Restart time and checkpoint overhead of a site as its log grows.
+// A single site holding `numVariables` variables commits `history`
+// transactions of `writesPerCommit` writes each, checkpointing every
+// `interval` commits (0 never does), then fails and recovers. Logs go to
+// the directory given as the only argument, otherwise to a fresh one under
+// /tmp removed at the end.
+#include <unistd.h>
+
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "options.hpp"
+#include "site.hpp"
+#include "topology.hpp"
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+const int numVariables = 1000;
+const int writesPerCommit = 4;
+
+struct Result {
+    // microseconds per commit
+    double commitUs;
+    // milliseconds to recover
+    double recoverMs;
+};
+
+Result bench(const string& dir, const int history, const int interval) {
+    Topology topology(1, numVariables, 0);
+    Options options;
+    options.walDir = dir;
+    options.durability = Durability::WRITE;
+    options.groupCommit = 64;
+    options.checkpointEvery = interval;
+    Site site(1, topology);
+    site.openLog(options);
+
+    unordered_set<int> affected;
+    vector<int> holders;
+    int time = 0;
+    auto start = Clock::now();
+    for (int t = 1; t <= history; t++) {
+        affected.clear();
+        for (int k = 0; k < writesPerCommit; k++) {
+            int idx = (t * 7 + k * 131) % numVariables + 1;
+            holders.clear();
+            site.write(t, idx, t, holders);
+            affected.insert(idx);
+        }
+        time++;
+        site.commit(t, affected, time, time);
+    }
+    double commitUs =
+        chrono::duration<double, micro>(Clock::now() - start).count() /
+        history;
+
+    site.fail(++time);
+    start = Clock::now();
+    site.recover(++time);
+    double recoverMs =
+        chrono::duration<double, milli>(Clock::now() - start).count();
+    site.closeLog();
+    return {commitUs, recoverMs};
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    string dir;
+    bool temporary = argc <= 1;
+    if (!temporary) {
+        dir = argv[1];
+    } else {
+        char pattern[] = "/tmp/checkpointBenchXXXXXX";
+        if (!mkdtemp(pattern)) {
+            cerr << "Error: can not create a log directory" << endl;
+            return 1;
+        }
+        dir = pattern;
+    }
+
+    cout << left << setw(10) << "history" << setw(10) << "interval"
+         << setw(16) << "commit(us)" << setw(16) << "recover(ms)" << endl;
+    for (int history = 12500; history <= 1250000; history *= 10) {
+        for (int interval : {0, 10000, 1000, 100}) {
+            auto result = bench(dir, history, interval);
+            cout << setw(10) << history << setw(10) << interval << setw(16)
+                 << result.commitUs << setw(16) << result.recoverMs << endl;
+        }
+    }
+    if (temporary) {
+        filesystem::remove_all(dir);
+    }
+    return 0;
+}
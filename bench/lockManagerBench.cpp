@@ -0,0 +1,124 @@
+// Cost of releasing a transaction's locks as the lock table grows.
+// Every round a transaction takes a handful of locks and then releases them
+// while `tableSize` locks held by other transactions stay in the table.
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "lockManager.hpp"
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+const int locksPerTransaction = 4;
+const int rounds = 20000;
+
+// release by walking both tables, as LockManager did before it kept an index
+struct ScanningTable {
+    unordered_map<int, unordered_set<int>> RLockTable;
+    unordered_map<int, int> WLockTable;
+
+    void release(const int transactionId) {
+        list<int> tmp;
+        for (auto& r : RLockTable) {
+            r.second.erase(transactionId);
+            if (r.second.empty()) {
+                tmp.push_back(r.first);
+            }
+        }
+        for (const auto& i : tmp) {
+            RLockTable.erase(i);
+        }
+        list<int> modifiedVar;
+        for (auto& w : WLockTable) {
+            if (w.second == transactionId) {
+                modifiedVar.push_back(w.first);
+            }
+        }
+        for (const auto& i : modifiedVar) {
+            WLockTable.erase(i);
+        }
+    }
+};
+
+double benchIndexed(const int tableSize) {
+    // the lock manager only locks the variables of its site
+    vector<int> variables(tableSize + locksPerTransaction);
+    iota(variables.begin(), variables.end(), 0);
+    LockManager lockManager(variables);
+    for (int i = 0; i < tableSize; i++) {
+        int holder = -1;
+        vector<int> holders;
+        if (i % 2) {
+            lockManager.requestRLock(i + 1, i, holder);
+        } else {
+            lockManager.requestWLock(i + 1, i, holders);
+        }
+    }
+
+    const int transactionId = tableSize + 1;
+    auto start = Clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (int k = 0; k < locksPerTransaction; k++) {
+            int holder = -1;
+            vector<int> holders;
+            int varIdx = tableSize + k;
+            if (k % 2) {
+                lockManager.requestRLock(transactionId, varIdx, holder);
+            } else {
+                lockManager.requestWLock(transactionId, varIdx, holders);
+            }
+        }
+        lockManager.releaseLock(transactionId);
+    }
+    return chrono::duration<double, nano>(Clock::now() - start).count() /
+           rounds;
+}
+
+double benchScanning(const int tableSize) {
+    ScanningTable table;
+    for (int i = 0; i < tableSize; i++) {
+        if (i % 2) {
+            table.RLockTable[i].insert(i + 1);
+        } else {
+            table.WLockTable[i] = i + 1;
+        }
+    }
+
+    const int transactionId = tableSize + 1;
+    const int scanRounds = max(1, rounds * 100 / max(tableSize, 100));
+    auto start = Clock::now();
+    for (int r = 0; r < scanRounds; r++) {
+        for (int k = 0; k < locksPerTransaction; k++) {
+            int varIdx = tableSize + k;
+            if (k % 2) {
+                table.RLockTable[varIdx].insert(transactionId);
+            } else {
+                table.WLockTable[varIdx] = transactionId;
+            }
+        }
+        table.release(transactionId);
+    }
+    return chrono::duration<double, nano>(Clock::now() - start).count() /
+           scanRounds;
+}
+
+}  // namespace
+
+int main() {
+    cout << left << setw(12) << "tableSize" << setw(20) << "scan(ns/round)"
+         << setw(20) << "indexed(ns/round)" << endl;
+    for (int tableSize = 10; tableSize <= 100000; tableSize *= 10) {
+        cout << setw(12) << tableSize << setw(20) << benchScanning(tableSize)
+             << setw(20) << benchIndexed(tableSize) << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,126 @@
+// Trace loading throughput on a synthetic trace, in GB/s of text trace, for
+// the text parser and for the same trace converted to the binary format.
+// Usage: parserBench [megabytes]
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "binaryTrace.hpp"
+#include "operationReader.hpp"
+#include "traceParser.hpp"
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+size_t writeTrace(const string &path, const size_t bytes) {
+    mt19937 rng(1);
+    uniform_int_distribution<int> pickVar(1, 20);
+    uniform_int_distribution<int> pickVal(-1000, 100000);
+    ofstream out(path);
+    size_t written = 0;
+    int transactionId = 1;
+    while (written < bytes) {
+        string block = "// transaction " + to_string(transactionId) + "\n";
+        block += "begin(T" + to_string(transactionId) + ")\n";
+        for (int k = 0; k < 8; k++) {
+            string t = "T" + to_string(transactionId);
+            string x = "x" + to_string(pickVar(rng));
+            block += k % 2 ? "R(" + t + "," + x + ")\n"
+                           : "W(" + t + ", " + x + ", " +
+                                 to_string(pickVal(rng)) + ")\n";
+        }
+        block += "end(T" + to_string(transactionId) + ")\n";
+        if (transactionId % 1000 == 0) {
+            block += "fail(3)\nrecover(3)\ndump()\n";
+        }
+        out << block;
+        written += block.size();
+        transactionId++;
+    }
+    return written;
+}
+
+void report(const string &name, const size_t bytes, const size_t ops,
+            const Clock::time_point start) {
+    double seconds = chrono::duration<double>(Clock::now() - start).count();
+    cout << left << setw(22) << name << setw(12) << ops << setw(12)
+         << fixed << setprecision(3) << bytes / seconds / 1e9 << endl;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    size_t megabytes = argc > 1 ? atoi(argv[1]) : 256;
+    string path = "/tmp/repcrec_parser_bench." + to_string(getpid());
+    size_t bytes = writeTrace(path, megabytes << 20);
+    string binaryPath = path + ".bin";
+    {
+        OperationReader reader(path.c_str());
+        binaryTrace::Writer writer;
+        writer.open(binaryPath.c_str());
+        Operation operation;
+        while (reader.next(operation)) {
+            writer.write(operation);
+        }
+        writer.close();
+    }
+
+    cout << left << setw(22) << "reader" << setw(12) << "ops" << setw(12)
+         << "GB/s" << endl;
+    for (int run = 0; run < 3; run++) {
+        // memory-mapped, parsed in place
+        auto start = Clock::now();
+        OperationReader reader(path.c_str());
+        Operation operation;
+        size_t ops = 0;
+        while (reader.next(operation)) {
+            ops++;
+        }
+        report("mmap", bytes, ops, start);
+
+        // line by line through an istream, as for stdin and FIFOs
+        start = Clock::now();
+        ifstream in(path);
+        string line, error;
+        ops = 0;
+        while (getline(in, line)) {
+            ops += TraceParser::parseLine(line, operation, error) ==
+                   TraceParser::Result::OPERATION;
+        }
+        report("getline", bytes, ops, start);
+
+        // binary records, mmap and iterate
+        start = Clock::now();
+        OperationReader binaryReader(binaryPath.c_str());
+        ops = 0;
+        while (binaryReader.next(operation)) {
+            ops++;
+        }
+        report("binary mmap", bytes, ops, start);
+
+        // binary records in chunks through an istream
+        start = Clock::now();
+        ifstream binaryIn(binaryPath, ios::binary);
+        auto *cinBuffer = cin.rdbuf(binaryIn.rdbuf());
+        OperationReader chunkReader("-");
+        ops = 0;
+        while (chunkReader.next(operation)) {
+            ops++;
+        }
+        cin.rdbuf(cinBuffer);
+        report("binary chunks", bytes, ops, start);
+    }
+    remove(path.c_str());
+    remove(binaryPath.c_str());
+    return 0;
+}
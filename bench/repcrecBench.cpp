@@ -0,0 +1,320 @@
+// End-to-end throughput of TransactionManager on generated workloads.
+// Without arguments runs the default scenario suite; any workload flag runs a
+// single scenario instead. Results are one JSON document, written to stdout
+// or to the file given by --out.
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "options.hpp"
+#include "output.hpp"
+#include "replicaSelector.hpp"
+#include "topology.hpp"
+#include "transactionManager.hpp"
+#include "workload.hpp"
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+class NullBuffer : public streambuf {
+   protected:
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char *, streamsize n) override { return n; }
+};
+
+struct Result {
+    WorkloadSpec spec;
+    size_t operations;
+    double seconds;
+    Stats stats;
+};
+
+vector<WorkloadSpec> defaultSuite() {
+    vector<WorkloadSpec> suite;
+    WorkloadSpec base;
+    base.variables = 200;
+
+    WorkloadSpec spec = base;
+    spec.name = "uniform";
+    suite.push_back(spec);
+
+    spec = base;
+    spec.name = "read-heavy";
+    spec.readRatio = 0.95;
+    spec.readOnlyFraction = 0.3;
+    suite.push_back(spec);
+
+    spec = base;
+    spec.name = "write-heavy";
+    spec.readRatio = 0.3;
+    suite.push_back(spec);
+
+    spec = base;
+    spec.name = "skewed";
+    spec.zipfTheta = 0.99;
+    suite.push_back(spec);
+
+    spec = base;
+    spec.name = "failures";
+    spec.failEvery = 1000;
+    suite.push_back(spec);
+
+    spec = base;
+    spec.name = "long";
+    spec.length = 32;
+    spec.transactions = 2500;
+    suite.push_back(spec);
+    return suite;
+}
+
+Result run(const WorkloadSpec &spec, const Options &options,
+           const OutputMode outputMode) {
+    Topology topology(spec.sites, spec.variables, spec.replicas);
+    auto ops = generateWorkload(spec);
+    size_t numOps = ops.size();
+
+    NullBuffer nullBuffer;
+    auto *coutBuffer = cout.rdbuf(&nullBuffer);
+    output().setMode(outputMode);
+    auto start = Clock::now();
+    TransactionManager tm(move(ops), topology, options);
+    tm.simulate();
+    output().flush();
+    double seconds = chrono::duration<double>(Clock::now() - start).count();
+    output().setMode(OutputMode::BUFFERED);
+    cout.rdbuf(coutBuffer);
+    return {spec, numOps, seconds, tm.getStats()};
+}
+
+const char *engineName(const Engine engine) {
+    switch (engine) {
+        case Engine::LOCKING:
+            return "2pl";
+        case Engine::OPTIMISTIC:
+            return "occ";
+        case Engine::SNAPSHOT:
+            return "si";
+        case Engine::SERIALIZABLE_SNAPSHOT:
+            return "ssi";
+    }
+    return "";
+}
+
+const char *deadlockPolicyName(const DeadlockPolicy policy) {
+    switch (policy) {
+        case DeadlockPolicy::DETECT:
+            return "detect";
+        case DeadlockPolicy::WAIT_DIE:
+            return "wait-die";
+        case DeadlockPolicy::WOUND_WAIT:
+            return "wound-wait";
+    }
+    return "";
+}
+
+// busiest site's share of the granted reads over an even share
+double readImbalance(const vector<long long> &siteReads) {
+    long long total = 0, busiest = 0;
+    for (const auto &reads : siteReads) {
+        total += reads;
+        busiest = max(busiest, reads);
+    }
+    return total ? double(busiest) * siteReads.size() / total : 0.0;
+}
+
+void writeJson(ostream &os, const vector<Result> &results,
+               const Options &options) {
+    os << "{\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto &r = results[i];
+        const auto &s = r.spec;
+        long long ended = r.stats.commits + r.stats.aborts;
+        os << (i ? "," : "") << "\n    {";
+        os << "\"name\": \"" << s.name << "\", \"seed\": " << s.seed
+           << ", \"transactions\": " << s.transactions
+           << ", \"concurrency\": " << s.concurrency
+           << ", \"length\": " << s.length
+           << ", \"readRatio\": " << s.readRatio
+           << ", \"readOnlyFraction\": " << s.readOnlyFraction
+           << ", \"zipfTheta\": " << s.zipfTheta
+           << ", \"variables\": " << s.variables << ", \"sites\": " << s.sites
+           << ", \"replicas\": " << s.replicas
+           << ", \"failEvery\": " << s.failEvery
+           << ", \"downFor\": " << s.downFor;
+        os << ", \"operations\": " << r.operations
+           << ", \"seconds\": " << r.seconds
+           << ", \"opsPerSecond\": " << r.operations / r.seconds
+           << ", \"commits\": " << r.stats.commits
+           << ", \"aborts\": " << r.stats.aborts
+           << ", \"commitRate\": "
+           << (ended ? double(r.stats.commits) / ended : 0.0)
+           << ", \"abortRate\": "
+           << (ended ? double(r.stats.aborts) / ended : 0.0)
+           << ", \"deadlocks\": " << r.stats.deadlocks
+           << ", \"blocked\": " << r.stats.blocked
+           << ", \"deadlockSearches\": " << r.stats.deadlockSearches
+           << ", \"deadlockSearchSeconds\": "
+           << r.stats.deadlockSearchNs / 1e9
+           << ", \"validationFailures\": " << r.stats.validationFailures
+           << ", \"engine\": \"" << engineName(options.engine)
+           << "\", \"deadlockPolicy\": \""
+           << deadlockPolicyName(options.deadlockPolicy)
+           << "\", \"readPolicy\": \"" << readPolicyName(options.readPolicy)
+           << "\", \"siteReads\": [";
+        for (size_t site = 0; site < r.stats.siteReads.size(); site++) {
+            os << (site ? ", " : "") << r.stats.siteReads[site];
+        }
+        os << "], \"readImbalance\": " << readImbalance(r.stats.siteReads)
+           << "}";
+    }
+    os << "\n  ]\n}\n";
+}
+
+void usage() {
+    cerr << "Usage: repcrec_bench [--out file] [--threads N] [--pipeline]\n"
+            "       [--output buffered|async|quiet]\n"
+            "       [--read-policy first|round-robin|least-locks|random]\n"
+            "       [--engine 2pl|occ|si|ssi]\n"
+            "       [--deadlock detect|wait-die|wound-wait]\n"
+            "       [--detect-every N] [--detect-after N]\n"
+            "       [--name S] [--seed N] [--transactions N] "
+            "[--concurrency N]\n"
+            "       [--length N] [--read-ratio F] [--read-only F] "
+            "[--zipf F]\n"
+            "       [--sites N] [--variables N] [--replicas N]\n"
+            "       [--fail-every N] [--down-for N]"
+         << endl;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    string outFile;
+    Options options;
+    OutputMode outputMode = OutputMode::BUFFERED;
+    WorkloadSpec spec;
+    bool custom = false;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--pipeline") {
+            options.pipeline = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        string value = argv[++i];
+        if (arg == "--out") {
+            outFile = value;
+        } else if (arg == "--threads") {
+            options.siteThreads = stoi(value);
+        } else if (arg == "--read-policy") {
+            if (!parseReadPolicy(value, options.readPolicy)) {
+                usage();
+                return 1;
+            }
+        } else if (arg == "--engine") {
+            if (value == "2pl") {
+                options.engine = Engine::LOCKING;
+            } else if (value == "occ") {
+                options.engine = Engine::OPTIMISTIC;
+            } else if (value == "si") {
+                options.engine = Engine::SNAPSHOT;
+            } else if (value == "ssi") {
+                options.engine = Engine::SERIALIZABLE_SNAPSHOT;
+            } else {
+                usage();
+                return 1;
+            }
+        } else if (arg == "--deadlock") {
+            if (value == "detect") {
+                options.deadlockPolicy = DeadlockPolicy::DETECT;
+            } else if (value == "wait-die") {
+                options.deadlockPolicy = DeadlockPolicy::WAIT_DIE;
+            } else if (value == "wound-wait") {
+                options.deadlockPolicy = DeadlockPolicy::WOUND_WAIT;
+            } else {
+                usage();
+                return 1;
+            }
+        } else if (arg == "--detect-every") {
+            options.detectEvery = stoi(value);
+        } else if (arg == "--detect-after") {
+            options.detectAfter = stoi(value);
+        } else if (arg == "--output") {
+            if (value == "buffered") {
+                outputMode = OutputMode::BUFFERED;
+            } else if (value == "async") {
+                outputMode = OutputMode::ASYNC;
+            } else if (value == "quiet") {
+                outputMode = OutputMode::QUIET;
+            } else {
+                usage();
+                return 1;
+            }
+        } else {
+            custom = true;
+            if (arg == "--name") {
+                spec.name = value;
+            } else if (arg == "--seed") {
+                spec.seed = stoull(value);
+            } else if (arg == "--transactions") {
+                spec.transactions = stoi(value);
+            } else if (arg == "--concurrency") {
+                spec.concurrency = stoi(value);
+            } else if (arg == "--length") {
+                spec.length = stoi(value);
+            } else if (arg == "--read-ratio") {
+                spec.readRatio = stod(value);
+            } else if (arg == "--read-only") {
+                spec.readOnlyFraction = stod(value);
+            } else if (arg == "--zipf") {
+                spec.zipfTheta = stod(value);
+            } else if (arg == "--sites") {
+                spec.sites = stoi(value);
+            } else if (arg == "--variables") {
+                spec.variables = stoi(value);
+            } else if (arg == "--replicas") {
+                spec.replicas = stoi(value);
+            } else if (arg == "--fail-every") {
+                spec.failEvery = stoi(value);
+            } else if (arg == "--down-for") {
+                spec.downFor = stoi(value);
+            } else {
+                usage();
+                return 1;
+            }
+        }
+    }
+
+    vector<Result> results;
+    for (const auto &s : custom ? vector<WorkloadSpec>{spec} : defaultSuite()) {
+        results.push_back(run(s, options, outputMode));
+        const auto &r = results.back();
+        cerr << s.name << ": " << r.operations << " ops in " << r.seconds
+             << "s, " << r.stats.commits << " commits, " << r.stats.aborts
+             << " aborts, " << r.stats.deadlocks << " deadlocks" << endl;
+    }
+
+    if (outFile.empty()) {
+        output().flush();
+        writeJson(cout, results, options);
+    } else {
+        ofstream out(outFile);
+        if (!out) {
+            output().line() << "Error: cannot write " << outFile;
+            return 1;
+        }
+        writeJson(out, results, options);
+    }
+    return 0;
+}
@@ -0,0 +1,106 @@
+// Simulation throughput at 10, 100 and 1000 sites. The same random trace of
+// read/write transactions runs against a fully replicated layout and a
+// layout with three copies of every replicated variable.
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <random>
+#include <streambuf>
+
+#include "operation.hpp"
+#include "output.hpp"
+#include "topology.hpp"
+#include "transactionManager.hpp"
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+class NullBuffer : public streambuf {
+   protected:
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char*, streamsize n) override { return n; }
+};
+
+// `concurrency` transactions run interleaved, each doing `length` reads or
+// writes on uniformly chosen variables before it ends
+list<Operation> makeTrace(const int numVariables, const int transactions,
+                          const int concurrency, const int length) {
+    mt19937 rng(7);
+    uniform_int_distribution<int> pickVar(1, numVariables);
+    uniform_int_distribution<int> pickVal(0, 999);
+    bernoulli_distribution isWrite(0.3);
+
+    list<Operation> ops;
+    int time = 0;
+    auto push = [&](Operation op) {
+        op.timeStamp = ++time;
+        ops.push_back(op);
+    };
+    for (int base = 1; base <= transactions; base += concurrency) {
+        int last = min(transactions, base + concurrency - 1);
+        for (int t = base; t <= last; t++) {
+            Operation op;
+            op.action = Action::BEGIN;
+            op.transactionId = t;
+            push(op);
+        }
+        for (int k = 0; k < length; k++) {
+            for (int t = base; t <= last; t++) {
+                Operation op;
+                op.action = isWrite(rng) ? Action::WRITE : Action::READ;
+                op.transactionId = t;
+                op.varIdx = pickVar(rng);
+                op.val = pickVal(rng);
+                push(op);
+            }
+        }
+        for (int t = base; t <= last; t++) {
+            Operation op;
+            op.action = Action::END;
+            op.transactionId = t;
+            push(op);
+        }
+    }
+    return ops;
+}
+
+}  // namespace
+
+int main() {
+    const int numVariables = 2000;
+    const auto trace = makeTrace(numVariables, 2000, 8, 10);
+
+    NullBuffer nullBuffer;
+    auto* coutBuffer = cout.rdbuf();
+    cerr << left << setw(8) << "sites" << setw(10) << "replicas" << setw(12)
+         << "variables" << setw(12) << "ops" << setw(12) << "init(ms)"
+         << setw(12) << "run(ms)" << "ops/s" << endl;
+    for (const int numSites : {10, 100, 1000}) {
+        for (const int replicas : {0, 3}) {
+            auto start = Clock::now();
+            TransactionManager tm(trace,
+                                  Topology(numSites, numVariables, replicas));
+            auto built = Clock::now();
+            cout.rdbuf(&nullBuffer);
+            tm.simulate();
+            output().flush();
+            cout.rdbuf(coutBuffer);
+            auto done = Clock::now();
+
+            double initMs =
+                chrono::duration<double, milli>(built - start).count();
+            double runMs =
+                chrono::duration<double, milli>(done - built).count();
+            cerr << setw(8) << numSites << setw(10)
+                 << (replicas ? to_string(replicas) : "all") << setw(12)
+                 << numVariables << setw(12) << trace.size() << setw(12)
+                 << initMs << setw(12) << runMs
+                 << trace.size() / (runMs / 1000) << endl;
+        }
+    }
+    return 0;
+}
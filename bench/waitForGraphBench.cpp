@@ -0,0 +1,117 @@
+// Deadlock detection cost as the number of blocked transactions grows.
+// Compares the incremental WaitForGraph with the previous full rescan, which
+// ran a fresh DFS from every node after each READ/WRITE.
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "waitForGraph.hpp"
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+bool dfs(unordered_map<int, list<int>> &waitForGraph,
+         unordered_set<int> &visited, int curNode, list<int> &path) {
+    path.push_back(curNode);
+    if (visited.count(curNode)) {
+        return true;
+    }
+    if (!waitForGraph.count(curNode)) {
+        return false;
+    }
+    visited.insert(curNode);
+    for (auto &next : waitForGraph[curNode]) {
+        if (dfs(waitForGraph, visited, next, path)) {
+            return true;
+        }
+    }
+    path.pop_back();
+    return false;
+}
+
+bool hasCycle(unordered_map<int, list<int>> &waitForGraph, list<int> &path) {
+    for (auto &n : waitForGraph) {
+        unordered_set<int> visited;
+        if (dfs(waitForGraph, visited, n.first, path)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// (holder, waiter) edges in the order transactions block; the last edge
+// closes a cycle so both detectors have to find exactly one deadlock
+vector<pair<int, int>> makeEdges(const string &shape, int n) {
+    vector<pair<int, int>> edges;
+    mt19937 rng(42);
+    for (int i = 2; i <= n; i++) {
+        if (shape == "chain") {
+            edges.emplace_back(i - 1, i);
+        } else {
+            // every new transaction waits on a random older one
+            uniform_int_distribution<int> pick(1, i - 1);
+            edges.emplace_back(pick(rng), i);
+        }
+    }
+    edges.emplace_back(n, 1);
+    return edges;
+}
+
+double runRescan(const vector<pair<int, int>> &edges, int &deadlocks) {
+    unordered_map<int, list<int>> graph;
+    auto start = Clock::now();
+    for (const auto &[holder, waiter] : edges) {
+        graph[holder].push_back(waiter);
+        list<int> path;
+        deadlocks += hasCycle(graph, path);
+    }
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+double runIncremental(const vector<pair<int, int>> &edges, int &deadlocks) {
+    WaitForGraph graph;
+    auto start = Clock::now();
+    for (const auto &[holder, waiter] : edges) {
+        graph.addEdge(holder, waiter);
+        vector<int> cycle;
+        if (graph.findCycle(cycle)) {
+            deadlocks++;
+            graph.removeTransaction(cycle.front());
+        }
+    }
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+}  // namespace
+
+int main() {
+    const int rescanLimit = 500;  // the old detector is cubic beyond this
+    cout << left << setw(8) << "shape" << setw(10) << "blocked" << setw(16)
+         << "rescan(ms)" << setw(16) << "incremental(ms)" << endl;
+    for (const string shape : {"chain", "tree"}) {
+        for (int n = 125; n <= 128000; n *= 2) {
+            auto edges = makeEdges(shape, n);
+            int rescanDeadlocks = 0, incDeadlocks = 0;
+            cout << setw(8) << shape << setw(10) << n << setw(16);
+            if (n <= rescanLimit) {
+                cout << runRescan(edges, rescanDeadlocks);
+            } else {
+                cout << "-";
+            }
+            cout << setw(16) << runIncremental(edges, incDeadlocks);
+            if (n <= rescanLimit && rescanDeadlocks != incDeadlocks) {
+                cout << " mismatch";
+            }
+            cout << endl;
+        }
+    }
+    return 0;
+}
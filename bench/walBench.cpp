@@ -0,0 +1,111 @@
+// Commit throughput of the redo log as the group commit size grows.
+// The first table appends commits of `writesPerCommit` variables straight to
+// a RedoLog; the second runs a generated workload through TransactionManager
+// with every site logging to its own file. Logs go to the directory given as
+// the only argument, otherwise to a fresh one under /tmp removed at the end.
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "options.hpp"
+#include "output.hpp"
+#include "redoLog.hpp"
+#include "topology.hpp"
+#include "transactionManager.hpp"
+#include "workload.hpp"
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+const int writesPerCommit = 4;
+const int commits = 2000;
+
+class NullBuffer : public streambuf {
+   protected:
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char *, streamsize n) override { return n; }
+};
+
+// commits per second and groups written
+pair<double, long long> benchLog(const string &dir,
+                                 const Durability durability,
+                                 const int groupCommit) {
+    RedoLog log;
+    if (!log.open(dir + "/bench.wal", durability, groupCommit)) {
+        return {0, 0};
+    }
+    vector<pair<Index, Value>> writes(writesPerCommit);
+    auto start = Clock::now();
+    for (int c = 0; c < commits; c++) {
+        for (int k = 0; k < writesPerCommit; k++) {
+            writes[k] = {(c + k) % 20 + 1, c};
+        }
+        log.append(c + 1, writes);
+    }
+    log.flush();
+    double seconds = chrono::duration<double>(Clock::now() - start).count();
+    return {commits / seconds, log.getStats().groups};
+}
+
+double benchSimulation(const string &dir, const int groupCommit) {
+    WorkloadSpec spec;
+    spec.variables = 200;
+    spec.transactions = 2000;
+    spec.readRatio = 0.5;
+    Topology topology(spec.sites, spec.variables, spec.replicas);
+    Options options;
+    options.walDir = dir;
+    options.groupCommit = groupCommit;
+
+    NullBuffer nullBuffer;
+    auto *coutBuffer = cout.rdbuf(&nullBuffer);
+    auto start = Clock::now();
+    TransactionManager tm(generateWorkload(spec), topology, options);
+    tm.simulate();
+    output().flush();
+    double seconds = chrono::duration<double>(Clock::now() - start).count();
+    cout.rdbuf(coutBuffer);
+    return tm.getStats().commits / seconds;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    string dir;
+    bool temporary = argc <= 1;
+    if (!temporary) {
+        dir = argv[1];
+    } else {
+        char pattern[] = "/tmp/walBenchXXXXXX";
+        if (!mkdtemp(pattern)) {
+            cerr << "Error: can not create a log directory" << endl;
+            return 1;
+        }
+        dir = pattern;
+    }
+
+    cout << left << setw(14) << "groupCommit" << setw(18) << "write(c/s)"
+         << setw(18) << "fsync(c/s)" << setw(10) << "fsyncs"
+         << setw(18) << "simulated(c/s)" << endl;
+    for (int groupCommit = 1; groupCommit <= 64; groupCommit *= 2) {
+        auto written = benchLog(dir, Durability::WRITE, groupCommit);
+        auto synced = benchLog(dir, Durability::FSYNC, groupCommit);
+        cout << setw(14) << groupCommit << setw(18) << written.first
+             << setw(18) << synced.first << setw(10) << synced.second
+             << setw(18) << benchSimulation(dir, groupCommit) << endl;
+    }
+    if (temporary) {
+        filesystem::remove_all(dir);
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include "workload.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+ZipfSampler::ZipfSampler(const int n, const double theta) : cdf(n) {
+    double sum = 0;
+    for (int k = 1; k <= n; k++) {
+        sum += 1.0 / pow(k, theta);
+        cdf[k - 1] = sum;
+    }
+    for (auto &c : cdf) {
+        c /= sum;
+    }
+}
+
+int ZipfSampler::operator()(mt19937_64 &rng) const {
+    double u = uniform_real_distribution<double>(0, 1)(rng);
+    auto it = lower_bound(cdf.begin(), cdf.end(), u);
+    return min<int>(it - cdf.begin(), cdf.size() - 1) + 1;
+}
+
+namespace {
+
+struct Running {
+    int transactionId;
+    bool isReadOnly;
+    int opsLeft;
+};
+
+}  // namespace
+
+list<Operation> generateWorkload(const WorkloadSpec &spec) {
+    mt19937_64 rng(spec.seed);
+    ZipfSampler pickVar(spec.variables, spec.zipfTheta);
+    uniform_int_distribution<int> pickVal(0, 9999);
+    uniform_int_distribution<int> pickSite(1, spec.sites);
+    bernoulli_distribution isRead(spec.readRatio);
+    bernoulli_distribution isReadOnly(spec.readOnlyFraction);
+
+    list<Operation> ops;
+    int time = 0;
+    auto push = [&](const Action action, const int transactionId) {
+        Operation op;
+        op.action = action;
+        op.transactionId = transactionId;
+        op.timeStamp = ++time;
+        ops.push_back(op);
+        return &ops.back();
+    };
+
+    int nextId = 1;
+    vector<Running> running;
+    auto start = [&] {
+        Running t{nextId++, isReadOnly(rng), spec.length};
+        push(t.isReadOnly ? Action::BEGINRO : Action::BEGIN, t.transactionId);
+        running.push_back(t);
+    };
+    while (nextId <= spec.transactions &&
+           static_cast<int>(running.size()) < spec.concurrency) {
+        start();
+    }
+
+    // (operation count, site) of pending recoveries
+    vector<pair<int, int>> downSites;
+    int sinceFail = 0;
+    while (!running.empty()) {
+        auto pick = uniform_int_distribution<size_t>(0, running.size() - 1);
+        size_t i = pick(rng);
+        auto &t = running[i];
+        if (t.opsLeft == 0) {
+            push(Action::END, t.transactionId);
+            running[i] = running.back();
+            running.pop_back();
+            if (nextId <= spec.transactions) {
+                start();
+            }
+        } else {
+            bool read = t.isReadOnly || isRead(rng);
+            auto op = push(read ? Action::READ : Action::WRITE,
+                           t.transactionId);
+            op->varIdx = pickVar(rng);
+            if (!read) {
+                op->val = pickVal(rng);
+            }
+            t.opsLeft--;
+        }
+
+        if (spec.failEvery > 0 && ++sinceFail == spec.failEvery) {
+            sinceFail = 0;
+            int siteId = pickSite(rng);
+            bool isDown = any_of(downSites.begin(), downSites.end(),
+                                 [&](auto &d) { return d.second == siteId; });
+            if (!isDown) {
+                push(Action::FAIL, -1)->siteId = siteId;
+                downSites.emplace_back(time + spec.downFor, siteId);
+            }
+        }
+        for (auto d = downSites.begin(); d != downSites.end();) {
+            if (d->first <= time) {
+                push(Action::RECOVER, -1)->siteId = d->second;
+                d = downSites.erase(d);
+            } else {
+                d++;
+            }
+        }
+    }
+    for (const auto &d : downSites) {
+        push(Action::RECOVER, -1)->siteId = d.second;
+    }
+    return ops;
+}
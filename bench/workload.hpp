@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "operation.hpp"
+
+// Shape of a synthetic workload. The same parameters and seed always
+// produce the same trace.
+struct WorkloadSpec {
+    std::string name = "default";
+    uint64_t seed = 1;
+    int transactions = 10000;
+    // transactions running at the same time
+    int concurrency = 16;
+    // reads and writes per transaction
+    int length = 8;
+    // fraction of read-write transaction operations that are reads
+    double readRatio = 0.8;
+    // fraction of transactions started with beginRO
+    double readOnlyFraction = 0.1;
+    // Zipfian skew of the variable chosen by each operation, 0 is uniform
+    double zipfTheta = 0.0;
+    int variables = 20;
+    int sites = 10;
+    // copies of each replicated variable, 0 for every site
+    int replicas = 0;
+    // a random site fails every `failEvery` operations (0 never) and
+    // recovers `downFor` operations later
+    int failEvery = 0;
+    int downFor = 50;
+};
+
+// Samples 1..n with P(k) proportional to 1 / k^theta.
+class ZipfSampler {
+   private:
+    std::vector<double> cdf;
+
+   public:
+    ZipfSampler(const int n, const double theta);
+    int operator()(std::mt19937_64 &rng) const;
+};
+
+// Interleaves the operations of `concurrency` transactions at random; when a
+// transaction ends the next one begins.
+std::list<Operation> generateWorkload(const WorkloadSpec &spec);
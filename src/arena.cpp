@@ -0,0 +1,53 @@
+#include "arena.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+void *Arena::do_allocate(size_t bytes, size_t alignment) {
+    while (current < blocks.size()) {
+        auto &block = blocks[current];
+        size_t start = (used + alignment - 1) & ~(alignment - 1);
+        if (start + bytes <= block.size) {
+            used = start + bytes;
+            return block.data.get() + start;
+        }
+        current++;
+        used = 0;
+    }
+    // new[] aligns for any fundamental type, which covers every container
+    // node
+    size_t size = max(blockSize, bytes);
+    blocks.push_back({make_unique<byte[]>(size), size});
+    current = blocks.size() - 1;
+    used = bytes;
+    return blocks.back().data.get();
+}
+
+void Arena::reset() {
+    // a block grown for one large transaction is not kept
+    size_t kept = 0;
+    for (auto &block : blocks) {
+        if (block.size == blockSize) {
+            blocks[kept++] = move(block);
+        }
+    }
+    blocks.resize(kept);
+    current = 0;
+    used = 0;
+}
+
+Arena *ArenaPool::acquire() {
+    if (spare.empty()) {
+        arenas.push_back(make_unique<Arena>());
+        return arenas.back().get();
+    }
+    Arena *arena = spare.back();
+    spare.pop_back();
+    return arena;
+}
+
+void ArenaPool::release(Arena *arena) {
+    arena->reset();
+    spare.push_back(arena);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+// Bump allocator behind the containers of one transaction. Deallocation is a
+// no-op; reset() frees everything at once when the transaction ends and
+// keeps the blocks for the next transaction using the arena.
+class Arena : public std::pmr::memory_resource {
+   private:
+    static constexpr size_t blockSize = 4096;
+
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+    std::vector<Block> blocks;
+    // block being carved and the offset of its first free byte
+    size_t current = 0;
+    size_t used = 0;
+
+   protected:
+    void *do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void *, size_t, size_t) override {}
+    bool do_is_equal(
+        const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+
+   public:
+    void reset();
+};
+
+// Owns the arenas of all transactions; those of ended transactions are
+// handed to the transactions that begin next.
+class ArenaPool {
+   private:
+    std::vector<std::unique_ptr<Arena>> arenas;
+    std::vector<Arena *> spare;
+
+   public:
+    Arena *acquire();
+    // everything allocated from `arena` must be destroyed already
+    void release(Arena *arena);
+};
@@ -0,0 +1,91 @@
+#include "binaryTrace.hpp"
+
+#include <cstring>
+
+using namespace std;
+
+namespace binaryTrace {
+
+bool isBinary(const char *data, const size_t size) {
+    return size >= sizeof(magic) && memcmp(data, magic, sizeof(magic)) == 0;
+}
+
+bool checkHeader(const Header &header, string &error) {
+    if (!isBinary(header.magic, sizeof(header.magic))) {
+        error = "not a binary trace";
+        return false;
+    }
+    if (header.version != version) {
+        error = "unsupported binary trace version " +
+                to_string(header.version);
+        return false;
+    }
+    if (header.recordSize != sizeof(Record)) {
+        error = "unexpected record size " + to_string(header.recordSize);
+        return false;
+    }
+    return true;
+}
+
+Record encode(const Operation &operation) {
+    int32_t val = operation.batch.empty()
+                      ? operation.val
+                      : static_cast<int32_t>(operation.batch.size());
+    return {static_cast<int32_t>(operation.action),
+            operation.transactionId,
+            operation.varIdx,
+            val,
+            operation.siteId,
+            operation.timeStamp};
+}
+
+bool decode(const Record &record, Operation &operation) {
+    if (record.action < static_cast<int32_t>(Action::READ) ||
+        record.action > static_cast<int32_t>(Action::MWRITE)) {
+        return false;
+    }
+    operation.batch.clear();
+    operation.action = static_cast<Action>(record.action);
+    operation.transactionId = record.transactionId;
+    operation.varIdx = record.varIdx;
+    operation.val = record.val;
+    operation.siteId = record.siteId;
+    operation.timeStamp = record.timeStamp;
+    return true;
+}
+
+void decodeItem(const Record &record, Operation &operation) {
+    operation.batch.emplace_back(record.varIdx, record.val);
+}
+
+bool Writer::open(const char *filename) {
+    out.open(filename, ios::binary | ios::trunc);
+    Header header{};
+    memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.recordSize = sizeof(Record);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    return static_cast<bool>(out);
+}
+
+void Writer::write(const Operation &operation) {
+    Record record = encode(operation);
+    out.write(reinterpret_cast<const char *>(&record), sizeof(record));
+    recordCount++;
+    for (const auto &[idx, val] : operation.batch) {
+        record.varIdx = idx;
+        record.val = val;
+        out.write(reinterpret_cast<const char *>(&record), sizeof(record));
+        recordCount++;
+    }
+}
+
+bool Writer::close() {
+    out.seekp(offsetof(Header, recordCount));
+    out.write(reinterpret_cast<const char *>(&recordCount),
+              sizeof(recordCount));
+    out.close();
+    return !out.fail();
+}
+
+}  // namespace binaryTrace
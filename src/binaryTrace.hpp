@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include "operation.hpp"
+
+// Binary trace format, version 1. A header followed by `recordCount`
+// fixed-size records in little-endian byte order:
+//
+//   header: magic "\x89RCT", version, record size, reserved, record count
+//   record: action, transactionId, varIdx, val, siteId, timeStamp
+//
+// A batch read or write is a record whose val counts the records that
+// follow it, one per variable with its varIdx and val.
+//
+// The first magic byte can not start a text trace, so readers tell the two
+// formats apart by it.
+namespace binaryTrace {
+
+constexpr char magic[4] = {'\x89', 'R', 'C', 'T'};
+constexpr uint32_t version = 1;
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t reserved;
+    uint64_t recordCount;
+};
+
+struct Record {
+    int32_t action;
+    int32_t transactionId;
+    int32_t varIdx;
+    int32_t val;
+    int32_t siteId;
+    int32_t timeStamp;
+};
+
+static_assert(sizeof(Header) == 24, "binary trace header must be packed");
+static_assert(sizeof(Record) == 24, "binary trace record must be packed");
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "binary traces are read and written in host byte order");
+
+bool isBinary(const char *data, const size_t size);
+// checks magic, version and record size
+bool checkHeader(const Header &header, std::string &error);
+Record encode(const Operation &operation);
+// a batch also needs the `val` records that follow, see decodeItem()
+bool decode(const Record &record, Operation &operation);
+void decodeItem(const Record &record, Operation &operation);
+
+// Writes a binary trace; the record count is filled in by close().
+class Writer {
+   private:
+    std::ofstream out;
+    uint64_t recordCount = 0;
+
+   public:
+    bool open(const char *filename);
+    void write(const Operation &operation);
+    bool close();
+};
+
+}  // namespace binaryTrace
@@ -0,0 +1,91 @@
+#include "checkpoint.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include "redoLog.hpp"
+#include "traceParser.hpp"
+
+using namespace std;
+
+namespace checkpoint {
+
+bool write(const string& path, const vector<pair<Index, Value>>& values,
+           const int time, const uint64_t logOffset,
+           const Durability durability) {
+    vector<char> image(sizeof(Header) + values.size() * sizeof(Entry));
+    char* out = image.data() + sizeof(Header);
+    for (const auto& [idx, value] : values) {
+        Entry entry{idx, value};
+        memcpy(out, &entry, sizeof(entry));
+        out += sizeof(entry);
+    }
+    Header header{};
+    memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.count = values.size();
+    header.checksum = RedoLog::checksum(image.data() + sizeof(Header),
+                                        image.size() - sizeof(Header));
+    header.time = time;
+    header.logOffset = logOffset;
+    memcpy(image.data(), &header, sizeof(header));
+
+    string tmpPath = path + ".tmp";
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        return false;
+    }
+    const char* data = image.data();
+    size_t left = image.size();
+    while (left > 0) {
+        ssize_t written = ::write(fd, data, left);
+        if (written <= 0) {
+            break;
+        }
+        data += written;
+        left -= written;
+    }
+    if (durability == Durability::FSYNC) {
+        ::fdatasync(fd);
+    }
+    ::close(fd);
+    return left == 0 && rename(tmpPath.c_str(), path.c_str()) == 0;
+}
+
+bool load(const string& path, vector<pair<Index, Value>>& values,
+          uint64_t& logOffset) {
+    MappedFile file;
+    if (!file.open(path.c_str())) {
+        return false;
+    }
+    auto data = file.data();
+    Header header;
+    if (data.size() < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    size_t entries = data.size() - sizeof(header);
+    if (memcmp(header.magic, magic, sizeof(magic)) != 0 ||
+        header.version != version ||
+        entries != size_t(header.count) * sizeof(Entry) ||
+        RedoLog::checksum(data.data() + sizeof(header), entries) !=
+            header.checksum) {
+        return false;
+    }
+    values.clear();
+    values.reserve(header.count);
+    const char* in = data.data() + sizeof(header);
+    for (uint32_t i = 0; i < header.count; i++) {
+        Entry entry;
+        memcpy(&entry, in, sizeof(entry));
+        in += sizeof(entry);
+        values.emplace_back(entry.idx, entry.value);
+    }
+    logOffset = header.logOffset;
+    return true;
+}
+
+}  // namespace checkpoint
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "options.hpp"
+#include "versionChain.hpp"
+
+// Checkpoint image of a site's committed values, version 1. A header
+// followed by `count` (index, value) entries in host byte order:
+//
+//   header: magic "RCCP", version, count, checksum of the entries,
+//           commit time, log offset
+//
+// The image holds every commit logged before byte `logOffset` of the site's
+// redo log, so recovery maps it and replays the log only from there.
+namespace checkpoint {
+
+constexpr char magic[4] = {'R', 'C', 'C', 'P'};
+constexpr uint32_t version = 1;
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t count;
+    uint32_t checksum;
+    int32_t time;
+    uint32_t reserved;
+    uint64_t logOffset;
+};
+
+struct Entry {
+    int32_t idx;
+    int32_t value;
+};
+
+static_assert(sizeof(Header) == 32, "checkpoint header must be packed");
+static_assert(sizeof(Entry) == 8, "checkpoint entry must be packed");
+
+// writes the image next to `path` and renames it over `path`, so a crash
+// leaves the previous checkpoint in place
+bool write(const std::string& path,
+           const std::vector<std::pair<Index, Value>>& values, const int time,
+           const uint64_t logOffset, const Durability durability);
+// false if `path` is missing or is not a complete image
+bool load(const std::string& path, std::vector<std::pair<Index, Value>>& values,
+          uint64_t& logOffset);
+
+}  // namespace checkpoint
@@ -1,102 +1,394 @@
 #include "lockManager.hpp"
 
-#include <iostream>
+#include <algorithm>
+
+#include "output.hpp"
+
 using namespace std;
 
+bool ReadLock::contains(const int transactionId) const {
+    for (int i = 0; i < count && i < inlineCapacity; i++) {
+        if (inlineIds[i] == transactionId) {
+            return true;
+        }
+    }
+    return find(overflow.begin(), overflow.end(), transactionId) !=
+           overflow.end();
+}
+
+bool ReadLock::insert(const int transactionId) {
+    if (contains(transactionId)) {
+        return false;
+    }
+    if (count < inlineCapacity) {
+        inlineIds[count] = transactionId;
+    } else {
+        overflow.push_back(transactionId);
+    }
+    count++;
+    return true;
+}
+
+bool ReadLock::erase(const int transactionId) {
+    int inlineCount = min(count, inlineCapacity);
+    for (int i = 0; i < inlineCount; i++) {
+        if (inlineIds[i] != transactionId) {
+            continue;
+        }
+        // refill the hole from the overflow so inline ids stay contiguous
+        if (!overflow.empty()) {
+            inlineIds[i] = overflow.back();
+            overflow.pop_back();
+        } else {
+            inlineIds[i] = inlineIds[inlineCount - 1];
+        }
+        count--;
+        return true;
+    }
+    auto it = find(overflow.begin(), overflow.end(), transactionId);
+    if (it == overflow.end()) {
+        return false;
+    }
+    *it = overflow.back();
+    overflow.pop_back();
+    count--;
+    return true;
+}
+
+void ReadLock::clear() {
+    count = 0;
+    overflow.clear();
+}
+
+SlotIndex::SlotIndex(const vector<int>& ids) {
+    if (ids.empty()) {
+        return;
+    }
+    bits.resize(static_cast<size_t>(ids.back()) / 64 + 1);
+    ranks.resize(bits.size());
+    for (const auto& id : ids) {
+        bits[id / 64] |= uint64_t(1) << (id % 64);
+    }
+    int below = 0;
+    for (size_t word = 0; word < bits.size(); word++) {
+        ranks[word] = below;
+        below += __builtin_popcountll(bits[word]);
+    }
+}
+
+LockManager::LockManager(const vector<int>& variables)
+    : variables(variables), lockTable(variables.size()) {
+    for (size_t i = 0; i < variables.size(); i++) {
+        int range = rangeOf(variables[i]);
+        if (ranges.empty() || ranges.back() != range) {
+            ranges.push_back(range);
+            rangeStart.push_back(i);
+        }
+    }
+    rangeStart.push_back(variables.size());
+    rangeTable.resize(ranges.size());
+    variableSlots = SlotIndex(variables);
+    rangeSlots = SlotIndex(ranges);
+}
+
+size_t LockManager::variablesIn(const int range) const {
+    if (range == wholeSite) {
+        return variables.size();
+    }
+    int slot = rangeSlotOf(range);
+    return slot == -1 ? 0 : rangeStart[slot + 1] - rangeStart[slot];
+}
+
+// the site only asks for locks on the variables it stores
+LockEntry& LockManager::entry(const int varIdx) {
+    return lockTable[slotOf(varIdx)];
+}
+
+GranuleLock& LockManager::granule(const int range) {
+    if (range == wholeSite) {
+        return siteLock;
+    }
+    return rangeTable[rangeSlotOf(range)];
+}
+
+const GranuleLock* LockManager::findGranule(const int range) const {
+    if (range == wholeSite) {
+        return &siteLock;
+    }
+    int slot = rangeSlotOf(range);
+    return slot == -1 ? nullptr : &rangeTable[slot];
+}
+
+vector<int>& LockManager::held(unordered_map<int, vector<int>>& table,
+                              const int transactionId) {
+    auto it = table.find(transactionId);
+    if (it != table.end()) {
+        return it->second;
+    }
+    if (spareHeld.empty()) {
+        return table[transactionId];
+    }
+    auto node = move(spareHeld.back());
+    spareHeld.pop_back();
+    node.key() = transactionId;
+    return table.insert(move(node)).position->second;
+}
+
+void LockManager::dropHeld(unordered_map<int, vector<int>>& table,
+                           unordered_map<int, vector<int>>::iterator entry) {
+    auto node = table.extract(entry);
+    node.mapped().clear();
+    spareHeld.push_back(move(node));
+}
+
+void LockManager::addIntent(const int varIdx, const int delta) {
+    granule(rangeOf(varIdx)).intentWriters += delta;
+    siteLock.intentWriters += delta;
+}
+
+void LockManager::rangeReaders(const int transactionId, const int varIdx,
+                               vector<int>& lockHolders) const {
+    for (const auto* lock : {&siteLock, findGranule(rangeOf(varIdx))}) {
+        if (lock && !lock->readers.empty()) {
+            lock->readers.forEach([&](int id) {
+                if (id != transactionId) {
+                    lockHolders.push_back(id);
+                }
+            });
+        }
+    }
+}
+
 void LockManager::requestRLock(int transactionId, int varIdx, int& lockHolder) {
+    auto& lock = entry(varIdx);
     // check whether a writelock on it
-    if (!WLockTable.count(varIdx)) {
+    if (lock.writer == -1) {
         // provide a RLock
-        if (RLockTable.count(varIdx)) {
-            RLockTable[varIdx].transactionIds.insert(transactionId);
-        } else {
-            ReadLock readLock;
-            readLock.transactionIds.insert(transactionId);
-            RLockTable[varIdx] = readLock;
+        if (lock.readers.insert(transactionId)) {
+            held(heldLocks, transactionId).push_back(slotOf(varIdx));
+            numLocks++;
+            counters.readLocks++;
         }
         return;
     }
     // else block this transaction
-    lockHolder = WLockTable[varIdx].transactionId;
+    lockHolder = lock.writer;
+    if (lockHolder != transactionId) {
+        counters.conflicts++;
+    }
     return;
 }
 
 void LockManager::requestWLock(const int transactionId, const int varIdx,
-                               unordered_set<int>& lockHolders) {
+                               vector<int>& lockHolders) {
+    auto& lock = entry(varIdx);
+    // a scan holding the range or the site blocks the IX
+    size_t scans = lockHolders.size();
+    rangeReaders(transactionId, varIdx, lockHolders);
+    scans = lockHolders.size() - scans;
     // check whether a readlock on it
-    if (!RLockTable.count(varIdx) && !WLockTable.count(varIdx)) {
+    if (lock.readers.empty() && lock.writer == -1 && !scans) {
         // provide a WLock
-        WriteLock writeLock;
-        writeLock.transactionId = transactionId;
-        WLockTable[varIdx] = writeLock;
+        lock.writer = transactionId;
+        held(heldLocks, transactionId).push_back(slotOf(varIdx));
+        addIntent(varIdx, 1);
+        numLocks++;
+        counters.writeLocks++;
         return;
     }
     // else block this transaction
-    if (RLockTable.count(varIdx)) {
-        auto ids = RLockTable[varIdx].transactionIds;
-        lockHolders.insert(ids.begin(), ids.end());
-    } else {
-        lockHolders.insert(WLockTable[varIdx].transactionId);
+    if (!lock.readers.empty()) {
+        lock.readers.forEach([&](int id) { lockHolders.push_back(id); });
+    } else if (lock.writer != -1) {
+        lockHolders.push_back(lock.writer);
+    }
+    if (scans || lockHolders.size() > 1 ||
+        lockHolders.front() != transactionId) {
+        counters.conflicts++;
     }
     return;
 }
 
 void LockManager::promoteLock(const int transactionId, const int idx) {
-    RLockTable.erase(idx);
-    WriteLock writeLock;
-    writeLock.transactionId = transactionId;
-    WLockTable[idx] = writeLock;
+    auto& lock = entry(idx);
+    bool wasHeld = lock.readers.contains(transactionId) ||
+                   lock.writer == transactionId;
+    numLocks -= lock.readers.size() + (lock.writer != -1);
+    lock.readers.clear();
+    if (lock.writer != transactionId) {
+        addIntent(idx, 1);
+    }
+    lock.writer = transactionId;
+    numLocks++;
+    counters.promotions++;
+    if (!wasHeld) {
+        held(heldLocks, transactionId).push_back(slotOf(idx));
+    }
+}
+
+void LockManager::requestRangeRLock(const int transactionId, const int range,
+                                    vector<int>& lockHolders) {
+    size_t writers = lockHolders.size();
+    rangeWriters(transactionId, range, lockHolders);
+    if (lockHolders.size() > writers) {
+        counters.conflicts++;
+        return;
+    }
+    if (granule(range).readers.insert(transactionId)) {
+        held(heldRanges, transactionId).push_back(range);
+        numLocks++;
+        counters.rangeLocks++;
+    }
+}
+
+int LockManager::writerOf(const int varIdx) const {
+    int slot = slotOf(varIdx);
+    return slot == -1 ? -1 : lockTable[slot].writer;
 }
 
-list<int> LockManager::releaseLock(const int transactionId) {
-    // check ReadLock
-    list<int> tmp;  // use to update ReadLock table
-    for (auto& r : RLockTable) {
-        r.second.transactionIds.erase(transactionId);
-        if (r.second.transactionIds.empty()) {
-            tmp.push_back(r.first);
+void LockManager::rangeWriters(const int transactionId, const int range,
+                               vector<int>& lockHolders) const {
+    const auto* lock = findGranule(range);
+    if (!lock || lock->intentWriters == 0) {
+        return;
+    }
+    // the variables of a range hold consecutive slots
+    size_t first = 0;
+    size_t last = lockTable.size();
+    if (range != wholeSite) {
+        int slot = rangeSlotOf(range);
+        first = rangeStart[slot];
+        last = rangeStart[slot + 1];
+    }
+    size_t before = lockHolders.size();
+    for (size_t i = first; i < last; i++) {
+        int writer = lockTable[i].writer;
+        if (writer != -1 && writer != transactionId &&
+            find(lockHolders.begin() + before, lockHolders.end(), writer) ==
+                lockHolders.end()) {
+            lockHolders.push_back(writer);
         }
     }
+}
+
+bool LockManager::canRLock(const int transactionId, const int varIdx) const {
+    int writer = writerOf(varIdx);
+    return writer == -1 || writer == transactionId;
+}
 
-    // clean up RLockTable
-    for (const auto& i : tmp) {
-        RLockTable.erase(i);
+bool LockManager::canWLock(const int transactionId, const int varIdx) const {
+    vector<int> lockHolders;
+    writeBlockers(transactionId, varIdx, lockHolders);
+    return lockHolders.empty();
+}
+
+void LockManager::writeBlockers(const int transactionId, const int varIdx,
+                                vector<int>& lockHolders) const {
+    rangeReaders(transactionId, varIdx, lockHolders);
+    int slot = slotOf(varIdx);
+    if (slot == -1) {
+        return;
+    }
+    // a transaction holding the only read lock promotes it
+    const auto& lock = lockTable[slot];
+    lock.readers.forEach([&](int id) {
+        if (id != transactionId) {
+            lockHolders.push_back(id);
+        }
+    });
+    if (lock.writer != -1 && lock.writer != transactionId) {
+        lockHolders.push_back(lock.writer);
     }
+}
 
-    // check WriteLock
-    list<int> modifiedVar;
-    for (auto& w : WLockTable) {
-        if (w.second.transactionId == transactionId) {
-            modifiedVar.push_back(w.first);
+vector<int> LockManager::releaseLock(const int transactionId) {
+    vector<int> modifiedVar;
+    auto ranges = heldRanges.find(transactionId);
+    if (ranges != heldRanges.end()) {
+        for (const auto& range : ranges->second) {
+            granule(range).readers.erase(transactionId);
+            numLocks--;
         }
+        dropHeld(heldRanges, ranges);
+    }
+    auto locks = heldLocks.find(transactionId);
+    if (locks == heldLocks.end()) {
+        return modifiedVar;
     }
 
-    // clean up WLockTable
-    for (const auto& i : modifiedVar) {
-        WLockTable.erase(i);
+    for (const auto& slot : locks->second) {
+        auto& lock = lockTable[slot];
+        int varIdx = variables[slot];
+        // check ReadLock
+        if (lock.readers.erase(transactionId)) {
+            numLocks--;
+        }
+        // check WriteLock
+        if (lock.writer == transactionId) {
+            modifiedVar.push_back(varIdx);
+            lock.writer = -1;
+            addIntent(varIdx, -1);
+            numLocks--;
+        }
     }
+    dropHeld(heldLocks, locks);
     return modifiedVar;
 }
 
 void LockManager::releaseAllLock() {
-    RLockTable.clear();
-    WLockTable.clear();
+    for (const auto& [transactionId, slots] : heldLocks) {
+        for (const auto& slot : slots) {
+            lockTable[slot].readers.clear();
+            lockTable[slot].writer = -1;
+        }
+    }
+    heldLocks.clear();
+    rangeTable.assign(ranges.size(), GranuleLock());
+    siteLock = GranuleLock();
+    heldRanges.clear();
+    numLocks = 0;
 }
 
+size_t LockManager::lockCount() const { return numLocks; }
+
 void LockManager::dump() const {
-    cout << "RLock Holders: ";
-    for (const auto& r : RLockTable) {
-        cout << r.first << " : ";
-        for (const auto& t : r.second.transactionIds) {
-            cout << t << " ";
+    {
+        auto line = output().line();
+        line << "RLock Holders: ";
+        for (size_t i = 0; i < lockTable.size(); i++) {
+            if (lockTable[i].readers.empty()) {
+                continue;
+            }
+            line << variables[i] << " : ";
+            lockTable[i].readers.forEach([&](int t) { line << t << " "; });
+            line << " || ";
+        }
+    }
+    {
+        auto line = output().line();
+        line << "Range RLock Holders: ";
+        if (!siteLock.readers.empty()) {
+            line << "site : ";
+            siteLock.readers.forEach([&](int t) { line << t << " "; });
+            line << " || ";
+        }
+        for (size_t r = 0; r < rangeTable.size(); r++) {
+            if (rangeTable[r].readers.empty()) {
+                continue;
+            }
+            line << "x" << ranges[r] * rangeSize + 1 << "-x"
+                 << (ranges[r] + 1) * rangeSize
+                 << " : ";
+            rangeTable[r].readers.forEach([&](int t) { line << t << " "; });
+            line << " || ";
         }
-        cout << " || ";
     }
-    cout << endl;
 
-    cout << "WLockHolders: ";
-    for (const auto& w : WLockTable) {
-        cout << w.first << " : " << w.second.transactionId << " || ";
+    auto line = output().line();
+    line << "WLockHolders: ";
+    for (size_t i = 0; i < lockTable.size(); i++) {
+        if (lockTable[i].writer != -1) {
+            line << variables[i] << " : " << lockTable[i].writer << " || ";
+        }
     }
-    cout << endl;
 }
@@ -1,36 +1,169 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <list>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 using namespace std;
 
+// Transactions sharing the read lock on one variable. The first few ids are
+// stored inline so the common one- or two-reader case never allocates.
 class ReadLock {
    public:
-    bool isShared;
-    unordered_set<int> transactionIds;
-    ReadLock() : isShared(true){};
+    static constexpr int inlineCapacity = 6;
+
+    bool contains(const int transactionId) const;
+    bool insert(const int transactionId);
+    bool erase(const int transactionId);
+    void clear();
+    bool empty() const { return count == 0; }
+    int size() const { return count; }
+
+    template <typename F>
+    void forEach(F&& f) const {
+        for (int i = 0; i < count && i < inlineCapacity; i++) {
+            f(inlineIds[i]);
+        }
+        for (const auto& id : overflow) {
+            f(id);
+        }
+    }
+
+   private:
+    int count = 0;
+    int inlineIds[inlineCapacity];
+    vector<int> overflow;
 };
 
-class WriteLock {
+// Positions of the ids of an ascending list, found in one step: a bit per id
+// up to the largest one, and the number of ids below each 64-bit word. About
+// a fifth of a byte per id, where an array of positions would take four.
+class SlotIndex {
    public:
-    bool isShared;
-    int transactionId;
-    WriteLock() : isShared(false){};
+    SlotIndex() {}
+    explicit SlotIndex(const vector<int>& ids);
+
+    // -1 if `id` is not in the list
+    int find(const int id) const {
+        size_t word = static_cast<size_t>(id) / 64;
+        if (id < 0 || word >= bits.size()) {
+            return -1;
+        }
+        uint64_t bit = uint64_t(1) << (id % 64);
+        if (!(bits[word] & bit)) {
+            return -1;
+        }
+        return ranks[word] + __builtin_popcountll(bits[word] & (bit - 1));
+    }
+
+   private:
+    vector<uint64_t> bits;
+    vector<int> ranks;
+};
+
+// All lock state of one variable; sized to a single cache line.
+class alignas(64) LockEntry {
+   public:
+    int writer = -1;  // transaction holding the write lock, -1 if none
+    ReadLock readers;
+};
+
+// Lock on a range of variables or on the whole site. Scans take S on it, and
+// every X lock on a variable below counts as an IX on it. Nothing above the
+// variables is ever locked in X, so IS would never conflict and is not kept.
+struct GranuleLock {
+    ReadLock readers;
+    int intentWriters = 0;
 };
 
 class LockManager {
+   public:
+    // locks granted and requests refused since the site started
+    struct Counters {
+        long long readLocks = 0;
+        long long writeLocks = 0;
+        // S locks on a range or on the whole site
+        long long rangeLocks = 0;
+        long long promotions = 0;
+        long long conflicts = 0;
+    };
+
+    // variables (rangeSize * r, rangeSize * (r + 1)] form range r
+    static constexpr int rangeSize = 10;
+    // the range standing for every variable of the site
+    static constexpr int wholeSite = -1;
+    static int rangeOf(const int varIdx) { return (varIdx - 1) / rangeSize; }
+
    private:
-    // transaction's locks for variable
-    unordered_map<int, ReadLock> RLockTable;
-    unordered_map<int, WriteLock> WLockTable;
+    // variables stored on the site, ascending; each one's lock lives in the
+    // slot of its position, so the tables only grow with what the site stores
+    vector<int> variables;
+    SlotIndex variableSlots;
+    // ranges holding any of them, ascending, and the first slot of each,
+    // followed by the number of variables
+    vector<int> ranges;
+    SlotIndex rangeSlots;
+    vector<size_t> rangeStart;
+    vector<LockEntry> lockTable;
+    vector<GranuleLock> rangeTable;
+    GranuleLock siteLock;
+    // slots of the variables each transaction holds a lock on, so release
+    // only visits the locks the transaction actually owns
+    unordered_map<int, vector<int>> heldLocks;
+    unordered_map<int, vector<int>> heldRanges;
+    // entries of released transactions, reused with their capacity by the
+    // next ones so taking and releasing locks stops allocating
+    vector<unordered_map<int, vector<int>>::node_type> spareHeld;
+    size_t numLocks = 0;
+    Counters counters;
+
+    // position of the variable or range in its table, -1 if the site stores
+    // none of it
+    int slotOf(const int varIdx) const { return variableSlots.find(varIdx); }
+    int rangeSlotOf(const int range) const { return rangeSlots.find(range); }
+    LockEntry& entry(const int varIdx);
+    GranuleLock& granule(const int range);
+    const GranuleLock* findGranule(const int range) const;
+    // the transaction's entry in `heldLocks` or `heldRanges`
+    vector<int>& held(unordered_map<int, vector<int>>& table,
+                      const int transactionId);
+    void dropHeld(unordered_map<int, vector<int>>& table,
+                  unordered_map<int, vector<int>>::iterator entry);
+    // the IX a new X lock on the variable implies, or the end of it
+    void addIntent(const int varIdx, const int delta);
+    // other transactions holding S above the variable
+    void rangeReaders(const int transactionId, const int varIdx,
+                      vector<int>& lockHolders) const;
 
    public:
-    list<int> releaseLock(const int transactionId);
+    LockManager() {}
+    explicit LockManager(const vector<int>& variables);
+
+    // number of the site's variables in the range
+    size_t variablesIn(const int range) const;
+    vector<int> releaseLock(const int transactionId);
 
     void requestRLock(int transactionId, int varIdx, int& lockHolder);
     void requestWLock(const int transactionId, const int varIdx,
-                      unordered_set<int>& lockHolders);
+                      vector<int>& lockHolders);
     void promoteLock(const int transactionId, const int idx);
+    // S on a range, or on the whole site, unless another transaction holds
+    // an X lock below it; those are added to `lockHolders`
+    void requestRangeRLock(const int transactionId, const int range,
+                           vector<int>& lockHolders);
+    // the transactions requestRLock() or requestRangeRLock() would wait for
+    int writerOf(const int varIdx) const;
+    void rangeWriters(const int transactionId, const int range,
+                      vector<int>& lockHolders) const;
+    // whether a request would be granted now, without taking the lock
+    bool canRLock(const int transactionId, const int varIdx) const;
+    bool canWLock(const int transactionId, const int varIdx) const;
+    // the other transactions a write lock on the variable would wait for
+    void writeBlockers(const int transactionId, const int varIdx,
+                       vector<int>& lockHolders) const;
     void releaseAllLock();
+    size_t lockCount() const;
+    const Counters& getCounters() const { return counters; }
     void dump() const;
 };
@@ -0,0 +1,152 @@
+#include "metrics.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+size_t bucketOf(const uint64_t value) {
+    return value == 0 ? 0 : 64 - __builtin_clzll(value);
+}
+
+const char *actionName(const Action action) {
+    switch (action) {
+        case Action::READ:
+            return "read";
+        case Action::WRITE:
+            return "write";
+        case Action::BEGIN:
+            return "begin";
+        case Action::BEGINRO:
+            return "beginRO";
+        case Action::END:
+            return "end";
+        case Action::RECOVER:
+            return "recover";
+        case Action::FAIL:
+            return "fail";
+        case Action::DUMP:
+            return "dump";
+        case Action::STATS:
+            return "stats";
+        case Action::SCAN:
+            return "scan";
+        case Action::MREAD:
+            return "batchRead";
+        case Action::MWRITE:
+            return "batchWrite";
+    }
+    return "";
+}
+
+}  // namespace
+
+void Histogram::record(const uint64_t value) {
+    buckets[bucketOf(value)]++;
+    count++;
+    sum += value;
+    max = std::max(max, value);
+}
+
+uint64_t Histogram::percentile(const double p) const {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = std::max(uint64_t(1), uint64_t(p / 100 * count + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            uint64_t upper = i == 0 ? 0 : i >= 64 ? max : (1ull << i) - 1;
+            return std::min(upper, max);
+        }
+    }
+    return max;
+}
+
+void Histogram::writeJson(ostream &os) const {
+    os << "{\"count\": " << count << ", \"sum\": " << sum
+       << ", \"max\": " << max << ", \"p50\": " << percentile(50)
+       << ", \"p90\": " << percentile(90) << ", \"p99\": " << percentile(99)
+       << "}";
+}
+
+void Metrics::completed(const Action action, const int ticks) {
+    this->ticks[static_cast<size_t>(action)].record(ticks);
+}
+
+void Metrics::processed(const Action action, const uint64_t ns) {
+    wallNs[static_cast<size_t>(action)].record(ns);
+}
+
+void Metrics::waited(const int var, const int ticks) {
+    lockWait.record(ticks);
+    auto &wait = variableWaits[var];
+    wait.waits++;
+    wait.ticks += ticks;
+    wait.maxTicks = max<long long>(wait.maxTicks, ticks);
+}
+
+void Metrics::queued(const size_t depth) { queueDepth.record(depth); }
+
+void Metrics::deadlock(const size_t cycleLength) {
+    this->cycleLength.record(cycleLength);
+}
+
+void Metrics::aborted(const AbortReason reason) {
+    aborts[static_cast<size_t>(reason)]++;
+}
+
+void Metrics::writeJson(ostream &os, const int time,
+                        const vector<SiteMetrics> &sites) const {
+    os << "{\"time\": " << time << ", \"operations\": {";
+    const char *delim = "";
+    for (int a = static_cast<int>(Action::READ);
+         a <= static_cast<int>(Action::MWRITE); a++) {
+        os << delim << "\"" << actionName(static_cast<Action>(a))
+           << "\": {\"ticks\": ";
+        ticks[a].writeJson(os);
+        os << ", \"wallNs\": ";
+        wallNs[a].writeJson(os);
+        os << "}";
+        delim = ", ";
+    }
+    os << "}, \"lockWait\": {\"ticks\": ";
+    lockWait.writeJson(os);
+    os << ", \"variables\": [";
+    delim = "";
+    for (const auto &[var, wait] : variableWaits) {
+        os << delim << "{\"var\": " << var << ", \"waits\": " << wait.waits
+           << ", \"ticks\": " << wait.ticks
+           << ", \"maxTicks\": " << wait.maxTicks << "}";
+        delim = ", ";
+    }
+    os << "]}, \"queueDepth\": ";
+    queueDepth.writeJson(os);
+    os << ", \"deadlocks\": {\"count\": " << cycleLength.size()
+       << ", \"cycleLength\": ";
+    cycleLength.writeJson(os);
+    os << "}, \"aborts\": {\"deadlock\": "
+       << aborts[static_cast<size_t>(AbortReason::DEADLOCK)]
+       << ", \"siteFailure\": "
+       << aborts[static_cast<size_t>(AbortReason::SITE_FAILURE)]
+       << ", \"noReplica\": "
+       << aborts[static_cast<size_t>(AbortReason::NO_REPLICA)]
+       << ", \"validation\": "
+       << aborts[static_cast<size_t>(AbortReason::VALIDATION)]
+       << "}, \"sites\": [";
+    delim = "";
+    for (const auto &site : sites) {
+        os << delim << "{\"site\": " << site.siteId
+           << ", \"reads\": " << site.reads << ", \"writes\": " << site.writes
+           << ", \"unavailable\": " << site.unavailable
+           << ", \"readLocks\": " << site.readLocks
+           << ", \"writeLocks\": " << site.writeLocks
+           << ", \"promotions\": " << site.promotions
+           << ", \"rangeLocks\": " << site.rangeLocks
+           << ", \"conflicts\": " << site.conflicts << "}";
+        delim = ", ";
+    }
+    os << "]}";
+}
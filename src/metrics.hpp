@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <vector>
+
+#include "operation.hpp"
+
+// Distribution of non-negative samples in power-of-two buckets: bucket 0
+// holds 0 and bucket k holds [2^(k-1), 2^k).
+class Histogram {
+   private:
+    std::array<uint64_t, 65> buckets{};
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+
+   public:
+    void record(const uint64_t value);
+    uint64_t size() const { return count; }
+    // upper bound of the bucket holding the `p`-th percentile, at most max
+    uint64_t percentile(const double p) const;
+    // {"count", "sum", "max", "p50", "p90", "p99"}
+    void writeJson(std::ostream &os) const;
+};
+
+enum class AbortReason {
+    // chosen as the victim of a deadlock
+    DEADLOCK = 1,
+    // a site it read from or wrote to failed before it committed
+    SITE_FAILURE,
+    // a read-only transaction found no site with its snapshot
+    NO_REPLICA,
+    // an optimistic or snapshot transaction failed validation at commit
+    VALIDATION
+};
+
+// Lock and access counters of one site, kept by the site itself.
+struct SiteMetrics {
+    int siteId = 0;
+    long long reads = 0;
+    long long writes = 0;
+    // requests the site turned away while down or recovering
+    long long unavailable = 0;
+    long long readLocks = 0;
+    long long writeLocks = 0;
+    long long promotions = 0;
+    // S locks scans took on a whole range or site
+    long long rangeLocks = 0;
+    // lock requests that found another transaction's lock
+    long long conflicts = 0;
+};
+
+// What the transaction manager observed during a run. Every update is a
+// counter or histogram bump.
+class Metrics {
+   private:
+    struct VariableWait {
+        long long waits = 0;
+        long long ticks = 0;
+        long long maxTicks = 0;
+    };
+
+    // indexed by Action
+    std::array<Histogram, 13> ticks;
+    std::array<Histogram, 13> wallNs;
+    Histogram lockWait;
+    std::map<int, VariableWait> variableWaits;
+    Histogram queueDepth;
+    Histogram cycleLength;
+    std::array<long long, 5> aborts{};
+
+   public:
+    // logical ticks from the first time `action` ran until it completed
+    void completed(const Action action, const int ticks);
+    // wall time of running `action` once
+    void processed(const Action action, const uint64_t ns);
+    // a blocked request on `var` got its lock after `ticks`
+    void waited(const int var, const int ticks);
+    // a request was queued behind `depth - 1` others
+    void queued(const size_t depth);
+    void deadlock(const size_t cycleLength);
+    void aborted(const AbortReason reason);
+    void writeJson(std::ostream &os, const int time,
+                   const std::vector<SiteMetrics> &sites) const;
+};
@@ -1,7 +1,8 @@
 #include "operation.hpp"
 
 Operation::Operation()
-    : transactionId(-1), varIdx(-1), val(-1), siteId(-1), timeStamp(0){};
+    : transactionId(-1), varIdx(-1), val(-1), siteId(-1), timeStamp(0),
+      firstRun(0){};
 
 std::ostream& operator<<(std::ostream& os, const Action& action) {
     switch (action) {
@@ -29,6 +30,18 @@ std::ostream& operator<<(std::ostream& os, const Action& action) {
         case Action::DUMP:
             os << "DUMP";
             break;
+        case Action::STATS:
+            os << "STATS";
+            break;
+        case Action::SCAN:
+            os << "SCAN";
+            break;
+        case Action::MREAD:
+            os << "MREAD";
+            break;
+        case Action::MWRITE:
+            os << "MWRITE";
+            break;
     }
     return os;
 }
@@ -37,5 +50,8 @@ std::ostream& operator<<(std::ostream& os, const Operation& op) {
     os << "time: " << op.timeStamp << " Action: " << op.action
        << " transactionId: " << op.transactionId << " varIdx: " << op.varIdx
        << " val: " << op.val << " siteId: " << op.siteId;
+    for (const auto& [idx, val] : op.batch) {
+        os << " x" << idx << ": " << val;
+    }
     return os;
 }
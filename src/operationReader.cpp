@@ -0,0 +1,180 @@
+#include "operationReader.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace {
+// records read per chunk from a stream
+const size_t chunkRecords = 4096;
+}  // namespace
+
+OperationReader::OperationReader(const char *filename) : name(filename) {
+    if (name == "-") {
+        in = &cin;
+        opened = true;
+    } else if (mapped.open(filename)) {
+        rest = mapped.data();
+        opened = true;
+    } else {
+        // not a regular file, e.g. a FIFO
+        file.open(filename, ios::binary);
+        in = &file;
+        opened = file.is_open();
+    }
+    if (opened) {
+        isBinary = in ? in->peek() == static_cast<unsigned char>(
+                                          binaryTrace::magic[0])
+                      : binaryTrace::isBinary(rest.data(), rest.size());
+        if (isBinary) {
+            readHeader();
+        }
+    }
+}
+
+bool OperationReader::readHeader() {
+    binaryTrace::Header header;
+    if (in) {
+        in->read(reinterpret_cast<char *>(&header), sizeof(header));
+        if (in->gcount() != sizeof(header)) {
+            errorMessage = name + ": truncated binary trace header";
+            return false;
+        }
+    } else {
+        if (rest.size() < sizeof(header)) {
+            errorMessage = name + ": truncated binary trace header";
+            return false;
+        }
+        memcpy(&header, rest.data(), sizeof(header));
+        rest.remove_prefix(sizeof(header));
+        if (rest.size() / sizeof(binaryTrace::Record) < header.recordCount) {
+            errorMessage = name + ": binary trace is shorter than its " +
+                           to_string(header.recordCount) + " records";
+            return false;
+        }
+    }
+    string reason;
+    if (!binaryTrace::checkHeader(header, reason)) {
+        errorMessage = name + ": " + reason;
+        return false;
+    }
+    recordsLeft = header.recordCount;
+    return true;
+}
+
+bool OperationReader::next(Operation &operation) {
+    if (hasError()) {
+        return false;
+    }
+    return isBinary ? nextBinary(operation) : nextText(operation);
+}
+
+bool OperationReader::nextLine(string_view &text) {
+    if (in) {
+        if (!getline(*in, line)) {
+            return false;
+        }
+        text = line;
+    } else {
+        if (rest.empty()) {
+            return false;
+        }
+        auto newline = rest.find('\n');
+        text = rest.substr(0, newline);
+        rest.remove_prefix(newline == string_view::npos ? rest.size()
+                                                        : newline + 1);
+    }
+    lineNo++;
+    return true;
+}
+
+bool OperationReader::nextText(Operation &operation) {
+    string_view text;
+    while (nextLine(text)) {
+        string reason;
+        switch (TraceParser::parseLine(text, operation, reason)) {
+            case TraceParser::Result::SKIP:
+                continue;
+            case TraceParser::Result::ERROR:
+                errorMessage = name + ":" + to_string(lineNo) + ": " + reason +
+                               " in '" + string(text) + "'";
+                return false;
+            case TraceParser::Result::OPERATION:
+                operation.timeStamp = ++time;
+                return true;
+        }
+    }
+    return false;
+}
+
+bool OperationReader::nextRecord(const binaryTrace::Record *&record) {
+    if (recordsLeft == 0) {
+        return false;
+    }
+    if (!in) {
+        // mmap and iterate
+        record = reinterpret_cast<const binaryTrace::Record *>(rest.data());
+        rest.remove_prefix(sizeof(binaryTrace::Record));
+    } else {
+        if (chunkPos == chunk.size()) {
+            chunk.resize(min<uint64_t>(chunkRecords, recordsLeft));
+            in->read(reinterpret_cast<char *>(chunk.data()),
+                     chunk.size() * sizeof(binaryTrace::Record));
+            chunk.resize(in->gcount() / sizeof(binaryTrace::Record));
+            chunkPos = 0;
+            if (chunk.empty()) {
+                errorMessage = name + ": binary trace ends after " +
+                               to_string(recordNo) + " records";
+                return false;
+            }
+        }
+        record = &chunk[chunkPos++];
+    }
+    recordsLeft--;
+    recordNo++;
+    return true;
+}
+
+bool OperationReader::nextBinary(Operation &operation) {
+    const binaryTrace::Record *record = nullptr;
+    if (!nextRecord(record)) {
+        return false;
+    }
+    if (!binaryTrace::decode(*record, operation)) {
+        errorMessage = name + ": record " + to_string(recordNo) +
+                       " has unknown action " + to_string(record->action);
+        return false;
+    }
+    if (operation.action == Action::MREAD ||
+        operation.action == Action::MWRITE) {
+        // the operations rely on a batch holding its variables ascending,
+        // as the text parser leaves them
+        if (operation.val <= 0) {
+            errorMessage =
+                name + ": record " + to_string(recordNo) + " is an empty batch";
+            return false;
+        }
+        for (int items = operation.val; items > 0; items--) {
+            if (!nextRecord(record)) {
+                if (errorMessage.empty()) {
+                    errorMessage = name + ": binary trace ends inside a batch";
+                }
+                return false;
+            }
+            if (!operation.batch.empty() &&
+                record->varIdx <= operation.batch.back().first) {
+                errorMessage = name + ": record " + to_string(recordNo) +
+                               " puts x" + to_string(record->varIdx) +
+                               " after x" +
+                               to_string(operation.batch.back().first) +
+                               " in a batch";
+                return false;
+            }
+            binaryTrace::decodeItem(*record, operation);
+        }
+        operation.val = -1;
+    }
+    return true;
+}
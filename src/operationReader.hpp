@@ -0,0 +1,54 @@
+#pragma once
+
+#include <fstream>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "binaryTrace.hpp"
+#include "operation.hpp"
+#include "traceParser.hpp"
+
+// Reads a trace one operation at a time, as text or in the binary format
+// (see binaryTrace.hpp), told apart by the first byte. Regular files are
+// memory-mapped and read in place; stdin ("-") and FIFOs are read line by
+// line, or in chunks of records when binary.
+class OperationReader {
+   private:
+    std::string name;
+    MappedFile mapped;
+    std::string_view rest;  // unread part of the mapped file
+    std::ifstream file;
+    std::istream *in = nullptr;  // set when not memory-mapped
+    bool opened = false;
+    bool isBinary = false;
+    std::string errorMessage;
+
+    // text traces
+    std::string line;
+    int lineNo = 0;
+    int time = 0;
+
+    // binary traces
+    uint64_t recordsLeft = 0;
+    uint64_t recordNo = 0;
+    std::vector<binaryTrace::Record> chunk;
+    size_t chunkPos = 0;
+
+    bool readHeader();
+    bool nextLine(std::string_view &text);
+    bool nextText(Operation &operation);
+    bool nextRecord(const binaryTrace::Record *&record);
+    bool nextBinary(Operation &operation);
+
+   public:
+    OperationReader(const char *filename);
+    bool isOpen() const { return opened; }
+    // reads the next operation, false at the end of the trace or on a
+    // malformed line or record
+    bool next(Operation &operation);
+    bool hasError() const { return !errorMessage.empty(); }
+    // "<file>:<line>: <reason>" for the malformed line
+    const std::string &error() const { return errorMessage; }
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// How far a group of redo log records gets before the commits in it are
+// considered durable.
+enum class Durability {
+    // handed to the operating system
+    WRITE = 1,
+    // on stable storage
+    FSYNC
+};
+
+// Which replica serves a read of a replicated variable.
+enum class ReadPolicy {
+    // the lowest-numbered available site
+    FIRST_AVAILABLE = 1,
+    // each read starts one site further than the previous one
+    ROUND_ROBIN,
+    // the available site holding the fewest locks
+    LEAST_LOCKS,
+    // a site chosen at random
+    RANDOM
+};
+
+// How transactions waiting for each other are kept from deadlocking, by
+// their start times.
+enum class DeadlockPolicy {
+    // search the wait-for graph after every read and write and abort the
+    // youngest transaction of a cycle
+    DETECT = 1,
+    // a transaction may only wait for a younger one, otherwise it aborts
+    WAIT_DIE,
+    // a transaction waiting for a younger one aborts it
+    WOUND_WAIT
+};
+
+// How the transactions that read and write are kept serializable.
+enum class Engine {
+    // strict two-phase locking on every site
+    LOCKING = 1,
+    // reads take no locks, writes are buffered until commit, which aborts a
+    // transaction whose reads were overwritten by a commit in the meantime
+    OPTIMISTIC,
+    // reads see the snapshot taken at begin, writes are buffered and the
+    // first of two concurrent transactions writing a variable to commit wins
+    SNAPSHOT,
+    // SNAPSHOT, also aborting a transaction that would complete two
+    // consecutive rw-antidependencies between concurrent transactions
+    SERIALIZABLE_SNAPSHOT
+};
+
+// Settings of one simulation run.
+struct Options {
+    // worker threads executing site requests, 0 runs them on the caller
+    int siteThreads = 0;
+    // send commits and aborts to the sites without waiting for them
+    bool pipeline = false;
+    Engine engine = Engine::LOCKING;
+    ReadPolicy readPolicy = ReadPolicy::FIRST_AVAILABLE;
+    DeadlockPolicy deadlockPolicy = DeadlockPolicy::DETECT;
+    // DETECT searches after every `detectEvery` reads and writes, and only
+    // once some transaction has waited at least `detectAfter` ticks; with
+    // anything but 1 and 0 every cycle found is resolved in one pass
+    int detectEvery = 1;
+    int detectAfter = 0;
+    // seed of ReadPolicy::RANDOM
+    uint64_t seed = 1;
+    // file receiving a Chrome trace of the run, empty records nothing
+    std::string traceEvents;
+    // directory of the per-site redo logs, empty runs without logging
+    std::string walDir;
+    Durability durability = Durability::FSYNC;
+    // commits written to a redo log together
+    int groupCommit = 1;
+    // commits a site logs between two checkpoints, 0 never checkpoints
+    int checkpointEvery = 0;
+};
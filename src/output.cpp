@@ -0,0 +1,136 @@
+#include "output.hpp"
+
+#include <chrono>
+#include <deque>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+
+// text of the lines being built on this thread, innermost last; a deque
+// keeps the open ones in place when a nested line adds another
+thread_local deque<string> lineBuffers;
+thread_local size_t openLines = 0;
+
+}  // namespace
+
+Output::Line::~Line() {
+    if (!output) {
+        return;
+    }
+    text.push_back('\n');
+    output->append(text);
+    openLines--;
+}
+
+Output::Output(ostream &stream) : stream(stream) {}
+
+Output::~Output() {
+    stopWriter();
+    flush();
+}
+
+Output::Line Output::line() {
+    if (mode == OutputMode::QUIET) {
+        lines++;
+        static thread_local string unused;
+        return Line(nullptr, unused);
+    }
+    // a line opened while another one is built gets its own buffer
+    if (openLines == lineBuffers.size()) {
+        lineBuffers.emplace_back();
+    }
+    string &text = lineBuffers[openLines++];
+    text.clear();
+    return Line(this, text);
+}
+
+void Output::append(const string &text) {
+    lines++;
+    lock_guard<mutex> lock(mtx);
+    buffer.append(text);
+    if (buffer.size() < chunkSize) {
+        return;
+    }
+    if (mode == OutputMode::ASYNC) {
+        hasText.notify_one();
+    } else {
+        stream.write(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+}
+
+void Output::writeLoop() {
+    unique_lock<mutex> lock(mtx);
+    while (true) {
+        // lines are also written after a short wait, so a live trace shows
+        // its output without waiting for a full chunk
+        hasText.wait_for(lock, chrono::milliseconds(10), [this] {
+            return stopping || flushing || buffer.size() >= chunkSize;
+        });
+        // lines handed over before a flush request are all in `buffer` now
+        bool flushRequested = flushing;
+        if (!buffer.empty()) {
+            string text;
+            text.swap(spare);
+            text.swap(buffer);
+            lock.unlock();
+            stream.write(text.data(), text.size());
+            stream.flush();
+            lock.lock();
+            text.clear();
+            spare.swap(text);
+        }
+        if (flushRequested) {
+            flushing = false;
+            written.notify_all();
+        }
+        if (stopping && buffer.empty()) {
+            return;
+        }
+    }
+}
+
+void Output::stopWriter() {
+    if (!writer.joinable()) {
+        return;
+    }
+    {
+        lock_guard<mutex> lock(mtx);
+        stopping = true;
+    }
+    hasText.notify_one();
+    writer.join();
+    stopping = false;
+}
+
+void Output::setMode(const OutputMode newMode) {
+    stopWriter();
+    flush();
+    mode = newMode;
+    if (mode == OutputMode::ASYNC) {
+        writer = thread([this] { writeLoop(); });
+    }
+}
+
+void Output::flush() {
+    unique_lock<mutex> lock(mtx);
+    if (writer.joinable()) {
+        // the writer owns the stream while it runs
+        flushing = true;
+        hasText.notify_one();
+        written.wait(lock, [this] { return !flushing; });
+        return;
+    }
+    if (!buffer.empty()) {
+        stream.write(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+    stream.flush();
+}
+
+Output &output() {
+    static Output sink(cout);
+    return sink;
+}
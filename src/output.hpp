@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+enum class OutputMode {
+    // lines are collected and written in large chunks, same bytes as before
+    BUFFERED,
+    // a writer thread writes the collected lines
+    ASYNC,
+    // lines are counted and dropped
+    QUIET
+};
+
+// Sink for everything the simulator prints. Callers build a line with
+// `output().line() << ...`; the line is handed over, with its newline, when
+// the builder goes out of scope. Lines from different threads never mix.
+class Output {
+   public:
+    class Line {
+       private:
+        Output *output;  // nullptr when the line is not kept
+        std::string &text;
+
+       public:
+        Line(Output *output, std::string &text)
+            : output(output), text(text) {}
+        Line(const Line &) = delete;
+        ~Line();
+
+        template <typename T>
+        Line &operator<<(const T &value) {
+            if (!output) {
+                return *this;
+            }
+            if constexpr (std::is_same_v<T, char>) {
+                text.push_back(value);
+            } else if constexpr (std::is_integral_v<T> &&
+                                 !std::is_same_v<T, bool>) {
+                char digits[24];
+                auto end =
+                    std::to_chars(digits, digits + sizeof(digits), value);
+                text.append(digits, end.ptr);
+            } else if constexpr (std::is_convertible_v<const T &,
+                                                       std::string_view>) {
+                text.append(std::string_view(value));
+            } else {
+                std::ostringstream os;
+                os << value;
+                text.append(os.str());
+            }
+            return *this;
+        }
+    };
+
+   private:
+    // buffered text is written once it grows past this size
+    static constexpr size_t chunkSize = 1 << 16;
+
+    std::ostream &stream;
+    OutputMode mode = OutputMode::BUFFERED;
+    std::atomic<long long> lines{0};
+
+    std::mutex mtx;
+    std::string buffer;
+    // async mode
+    std::string spare;
+    std::thread writer;
+    std::condition_variable hasText, written;
+    bool stopping = false;
+    bool flushing = false;
+
+    void append(const std::string &text);
+    void writeLoop();
+    void stopWriter();
+
+   public:
+    explicit Output(std::ostream &stream);
+    ~Output();
+    Output(const Output &) = delete;
+
+    // flushes what was printed so far and switches to `mode`
+    void setMode(const OutputMode mode);
+    OutputMode getMode() const { return mode; }
+    Line line();
+    // writes every line handed over so far and flushes the stream
+    void flush();
+    // lines handed over since the start, in every mode
+    long long lineCount() const { return lines; }
+};
+
+// the sink writing to std::cout
+Output &output();
@@ -0,0 +1,171 @@
+#include "redoLog.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+// checksum of the rest of the record, count and commit time, followed by
+// `count` (index, value) pairs, all in host byte order
+struct RecordHeader {
+    uint32_t checksum;
+    uint32_t count;
+    int32_t commitTime;
+};
+
+}  // namespace
+
+uint32_t RedoLog::checksum(const char* data, const size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+RedoLog::RedoLog(RedoLog&& other) noexcept { *this = move(other); }
+
+RedoLog& RedoLog::operator=(RedoLog&& other) noexcept {
+    if (this != &other) {
+        close();
+        fd = exchange(other.fd, -1);
+        durability = other.durability;
+        groupCommit = other.groupCommit;
+        pending = move(other.pending);
+        pendingCommits = exchange(other.pendingCommits, 0);
+        failed = other.failed;
+        stats = other.stats;
+    }
+    return *this;
+}
+
+RedoLog::~RedoLog() { close(); }
+
+bool RedoLog::open(const string& path, const Durability durability,
+                   const int groupCommit) {
+    close();
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (fd == -1) {
+        return false;
+    }
+    this->durability = durability;
+    this->groupCommit = max(groupCommit, 1);
+    failed = false;
+    stats = Stats();
+    return true;
+}
+
+bool RedoLog::append(const int commitTime,
+                     const vector<pair<Index, Value>>& writes) {
+    if (fd == -1 || failed) {
+        return true;
+    }
+    size_t start = pending.size();
+    size_t size = sizeof(RecordHeader) + writes.size() * 2 * sizeof(int32_t);
+    pending.resize(start + size);
+    char* record = pending.data() + start;
+    RecordHeader header{0, static_cast<uint32_t>(writes.size()), commitTime};
+    memcpy(record, &header, sizeof(header));
+    char* out = record + sizeof(RecordHeader);
+    for (const auto& [idx, value] : writes) {
+        int32_t pair[2] = {idx, value};
+        memcpy(out, pair, sizeof(pair));
+        out += sizeof(pair);
+    }
+    header.checksum =
+        checksum(record + sizeof(uint32_t), size - sizeof(uint32_t));
+    memcpy(record, &header.checksum, sizeof(header.checksum));
+    stats.commits++;
+    if (++pendingCommits >= groupCommit) {
+        return flush();
+    }
+    return true;
+}
+
+bool RedoLog::flush() {
+    if (fd == -1 || failed || pending.empty()) {
+        return true;
+    }
+    const char* data = pending.data();
+    size_t left = pending.size();
+    while (left > 0 && !failed) {
+        ssize_t written = ::write(fd, data, left);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            failed = true;
+            break;
+        }
+        data += written;
+        left -= written;
+    }
+    if (!failed && durability == Durability::FSYNC && ::fdatasync(fd) != 0) {
+        failed = true;
+    }
+    // a group only partly on disk is not counted, so checkpoints never point
+    // past the records written whole
+    if (!failed) {
+        stats.groups++;
+        stats.bytes += pending.size();
+    }
+    pending.clear();
+    pendingCommits = 0;
+    return !failed;
+}
+
+bool RedoLog::close() {
+    if (fd == -1) {
+        return true;
+    }
+    bool written = flush();
+    ::close(fd);
+    fd = -1;
+    return written;
+}
+
+bool RedoLog::readFrom(const size_t from, vector<char>& data) const {
+    if (fd == -1) {
+        return false;
+    }
+    char buffer[1 << 16];
+    ssize_t got;
+    off_t offset = from;
+    while ((got = ::pread(fd, buffer, sizeof(buffer), offset)) > 0) {
+        data.insert(data.end(), buffer, buffer + got);
+        offset += got;
+    }
+    return true;
+}
+
+bool RedoLog::decode(const vector<char>& data, size_t& offset,
+                     int& commitTime, vector<pair<Index, Value>>& writes) {
+    RecordHeader header;
+    if (data.size() - offset < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data.data() + offset, sizeof(header));
+    size_t size = sizeof(header) + size_t(header.count) * 2 * sizeof(int32_t);
+    if (data.size() - offset < size ||
+        checksum(data.data() + offset + sizeof(uint32_t),
+                 size - sizeof(uint32_t)) != header.checksum) {
+        return false;
+    }
+    commitTime = header.commitTime;
+    writes.clear();
+    const char* in = data.data() + offset + sizeof(header);
+    for (uint32_t i = 0; i < header.count; i++) {
+        int32_t pair[2];
+        memcpy(pair, in, sizeof(pair));
+        in += sizeof(pair);
+        writes.emplace_back(pair[0], pair[1]);
+    }
+    offset += size;
+    return true;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "options.hpp"
+#include "versionChain.hpp"
+
+// Append-only redo log of the commits applied to one site. Each commit is
+// one record of (variable, value) pairs stamped with its commit time.
+// Records are collected into a group that is written with a single call, and
+// synced under Durability::FSYNC, once it holds `groupCommit` commits or
+// when flush() is called. After a write or sync fails the log keeps what it
+// holds for replay and takes no more records.
+class RedoLog {
+   public:
+    struct Stats {
+        long long commits = 0;
+        long long groups = 0;
+        long long bytes = 0;
+    };
+
+   private:
+    int fd = -1;
+    Durability durability = Durability::FSYNC;
+    int groupCommit = 1;
+    // encoded records of the group not written yet
+    std::vector<char> pending;
+    int pendingCommits = 0;
+    bool failed = false;
+    Stats stats;
+
+   public:
+    RedoLog() = default;
+    RedoLog(RedoLog&& other) noexcept;
+    RedoLog& operator=(RedoLog&& other) noexcept;
+    RedoLog(const RedoLog&) = delete;
+    RedoLog& operator=(const RedoLog&) = delete;
+    ~RedoLog();
+
+    // creates `path`, or empties it if it exists
+    bool open(const std::string& path, const Durability durability,
+              const int groupCommit);
+    bool isOpen() const { return fd != -1; }
+    bool hasFailed() const { return failed; }
+    // append(), flush() and close() return false from the call whose write
+    // or sync fails
+    bool append(const int commitTime,
+                const std::vector<std::pair<Index, Value>>& writes);
+    // writes the pending group
+    bool flush();
+    bool close();
+    // bytes written to the log so far
+    size_t size() const { return stats.bytes; }
+    // calls `apply(commitTime, idx, value)` for every write logged from byte
+    // `from` on, in commit order; a torn or corrupt tail ends the replay.
+    // Reads through the open log.
+    template <typename F>
+    void replay(F&& apply, const size_t from = 0) const {
+        std::vector<char> data;
+        if (!readFrom(from, data)) {
+            return;
+        }
+        size_t offset = 0;
+        int commitTime;
+        std::vector<std::pair<Index, Value>> writes;
+        while (decode(data, offset, commitTime, writes)) {
+            for (const auto& [idx, value] : writes) {
+                apply(commitTime, idx, value);
+            }
+        }
+    }
+    const Stats& getStats() const { return stats; }
+    // FNV-1a, also used by checkpoints
+    static uint32_t checksum(const char* data, const size_t size);
+
+   private:
+    bool readFrom(const size_t from, std::vector<char>& data) const;
+    static bool decode(const std::vector<char>& data, size_t& offset,
+                       int& commitTime,
+                       std::vector<std::pair<Index, Value>>& writes);
+};
@@ -1,86 +1,213 @@
 #include <fstream>
 #include <iostream>
-#include <list>
 #include <string>
 
-#include "operation.hpp"
+#include "binaryTrace.hpp"
+#include "operationReader.hpp"
+#include "options.hpp"
+#include "output.hpp"
+#include "replicaSelector.hpp"
+#include "topology.hpp"
 #include "transactionManager.hpp"
 using namespace std;
 
-class IOUtil {
-   public:
-    IOUtil() {}
-
-    IOUtil(const char* filename) {
-        ifstream infile(filename);
-        string line;
-        int time = 0;
-
-        while (getline(infile, line)) {
-            if (!isalpha(line[0])) {
-                continue;
-            }
-            Operation operation;
-            ++time;
-            switch (line[0]) {
-                case 'R': {
-                    operation = getReadOperation(line);
-                } break;
-
-                case 'W': {
-                    operation = getWriteOperation(line);
-                } break;
-
-                case 'b': {
-                    auto idx = line.find("(");
-                    if (idx == 5) {
-                        operation = getBeginOperation(line);
-                    } else if (idx == 7) {
-                        operation = getBeginROOperation(line);
-                    } else {
-                        cout << "Error: wrong operation." << endl;
-                        exit(1);
-                    }
-                } break;
-
-                case 'e': {
-                    operation = getEndOperation(line);
-                } break;
-
-                case 'd': {
-                    operation = getDumpOperation(line);
-                } break;
+namespace {
+void usage() {
+    output().line()
+        << "Usage: ./repcrec [--sites N] [--variables M] [--replicas K] "
+           "[--topology FILE] [--threads N] [--pipeline]\n"
+           "                [--output buffered|async|quiet] [--wal-dir DIR]\n"
+           "                [--durability write|fsync] [--group-commit N] "
+           "[--checkpoint-every N]\n"
+           "                [--read-policy first|round-robin|least-locks|random] "
+           "[--seed N]\n"
+           "                [--engine 2pl|occ|si|ssi] "
+           "[--deadlock detect|wait-die|wound-wait] "
+           "[--detect-every N] [--detect-after N]\n"
+           "                [--metrics FILE | -] [--trace-events FILE] "
+           "<input_file | ->";
+    output().line()
+        << "       ./repcrec convert <input_file | -> <binary_file>";
+}
 
-                case 'r': {
-                    operation = getRecoverOperation(line);
-                } break;
+// repcrec convert <input> <output>: writes a trace in the binary format
+int convert(const char* inputFile, const char* outputFile) {
+    OperationReader reader(inputFile);
+    if (!reader.isOpen()) {
+        output().line() << "Error: can not open " << inputFile;
+        return 1;
+    }
+    binaryTrace::Writer writer;
+    if (!writer.open(outputFile)) {
+        output().line() << "Error: can not write " << outputFile;
+        return 1;
+    }
+    Operation operation;
+    while (reader.next(operation)) {
+        writer.write(operation);
+    }
+    if (reader.hasError()) {
+        output().line() << "Error: " << reader.error();
+        return 1;
+    }
+    if (!writer.close()) {
+        output().line() << "Error: can not write " << outputFile;
+        return 1;
+    }
+    return 0;
+}
+}  // namespace
 
-                case 'f': {
-                    operation = getFailOperation(line);
-                } break;
+int main(int argc, char* argv[]) {
+    if (argc > 1 && string(argv[1]) == "convert") {
+        if (argc != 4) {
+            usage();
+            return 1;
+        }
+        return convert(argv[2], argv[3]);
+    }
 
-                default:
-                    cout << "Error: wrong operation." << endl;
-                    exit(1);
-                    break;
+    int sites = 10, variables = 20, replicas = 0;
+    const char* topologyFile = nullptr;
+    Options options;
+    OutputMode outputMode = OutputMode::BUFFERED;
+    const char* inputFile = nullptr;
+    const char* metricsFile = nullptr;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--sites" && hasValue) {
+            sites = atoi(argv[++i]);
+        } else if (arg == "--variables" && hasValue) {
+            variables = atoi(argv[++i]);
+        } else if (arg == "--replicas" && hasValue) {
+            replicas = atoi(argv[++i]);
+        } else if (arg == "--topology" && hasValue) {
+            topologyFile = argv[++i];
+        } else if (arg == "--threads" && hasValue) {
+            options.siteThreads = atoi(argv[++i]);
+        } else if (arg == "--pipeline") {
+            options.pipeline = true;
+        } else if (arg == "--output" && hasValue) {
+            string mode = argv[++i];
+            if (mode == "buffered") {
+                outputMode = OutputMode::BUFFERED;
+            } else if (mode == "async") {
+                outputMode = OutputMode::ASYNC;
+            } else if (mode == "quiet") {
+                outputMode = OutputMode::QUIET;
+            } else {
+                usage();
+                return 1;
+            }
+        } else if (arg == "--read-policy" && hasValue) {
+            if (!parseReadPolicy(argv[++i], options.readPolicy)) {
+                usage();
+                return 1;
+            }
+        } else if (arg == "--trace-events" && hasValue) {
+            options.traceEvents = argv[++i];
+        } else if (arg == "--metrics" && hasValue) {
+            metricsFile = argv[++i];
+        } else if (arg == "--engine" && hasValue) {
+            string engine = argv[++i];
+            if (engine == "2pl") {
+                options.engine = Engine::LOCKING;
+            } else if (engine == "occ") {
+                options.engine = Engine::OPTIMISTIC;
+            } else if (engine == "si") {
+                options.engine = Engine::SNAPSHOT;
+            } else if (engine == "ssi") {
+                options.engine = Engine::SERIALIZABLE_SNAPSHOT;
+            } else {
+                usage();
+                return 1;
             }
-            operation.timeStamp = time;
-            operations.push_back(operation);
+        } else if (arg == "--deadlock" && hasValue) {
+            string policy = argv[++i];
+            if (policy == "detect") {
+                options.deadlockPolicy = DeadlockPolicy::DETECT;
+            } else if (policy == "wait-die") {
+                options.deadlockPolicy = DeadlockPolicy::WAIT_DIE;
+            } else if (policy == "wound-wait") {
+                options.deadlockPolicy = DeadlockPolicy::WOUND_WAIT;
+            } else {
+                usage();
+                return 1;
+            }
+        } else if (arg == "--detect-every" && hasValue) {
+            options.detectEvery = atoi(argv[++i]);
+        } else if (arg == "--detect-after" && hasValue) {
+            options.detectAfter = atoi(argv[++i]);
+        } else if (arg == "--seed" && hasValue) {
+            options.seed = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--wal-dir" && hasValue) {
+            options.walDir = argv[++i];
+        } else if (arg == "--durability" && hasValue) {
+            string level = argv[++i];
+            if (level == "write") {
+                options.durability = Durability::WRITE;
+            } else if (level == "fsync") {
+                options.durability = Durability::FSYNC;
+            } else {
+                usage();
+                return 1;
+            }
+        } else if (arg == "--group-commit" && hasValue) {
+            options.groupCommit = atoi(argv[++i]);
+        } else if (arg == "--checkpoint-every" && hasValue) {
+            options.checkpointEvery = atoi(argv[++i]);
+        } else if (!inputFile && (arg == "-" || arg.rfind("--", 0) != 0)) {
+            inputFile = argv[i];
+        } else {
+            usage();
+            return 1;
         }
     }
+    if (!inputFile || sites <= 0 || variables <= 0 || replicas < 0 ||
+        options.siteThreads < 0 || options.groupCommit <= 0 ||
+        options.checkpointEvery < 0) {
+        usage();
+        return 1;
+    }
 
-    list<Operation> operations;
-};
+    Topology topology(sites, variables, replicas);
+    if (topologyFile) {
+        string error;
+        if (!Topology::load(topologyFile, topology, error)) {
+            output().line() << "Error: " << error;
+            return 1;
+        }
+    }
 
-int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        cout << "Usage: ./repcrec <input_file>" << endl;
+    OperationReader reader(inputFile);
+    if (!reader.isOpen()) {
+        output().line() << "Error: can not open " << inputFile;
         return 1;
     }
 
-    IOUtil ioUtil(argv[argc - 1]);
-
-    TransactionManager tm(ioUtil.operations);
+    output().setMode(outputMode);
+    TransactionManager tm(reader, topology, options);
     tm.simulate();
+    // errors are printed in every mode
+    output().setMode(OutputMode::BUFFERED);
+    if (outputMode == OutputMode::QUIET) {
+        cerr << output().lineCount() << " events" << endl;
+    }
+    if (metricsFile && string(metricsFile) == "-") {
+        tm.printMetrics();
+    } else if (metricsFile) {
+        ofstream out(metricsFile);
+        tm.writeMetrics(out);
+        out << "\n";
+        if (!out) {
+            output().line() << "Error: can not write " << metricsFile;
+            return 1;
+        }
+    }
+    if (reader.hasError()) {
+        output().line() << "Error: " << reader.error();
+        return 1;
+    }
     return 0;
 }
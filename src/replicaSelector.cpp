@@ -0,0 +1,60 @@
+#include "replicaSelector.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace std;
+
+const vector<int>& ReplicaSelector::order(const vector<int>& siteIds,
+                                          const vector<size_t>& locks) {
+    if (policy == ReadPolicy::FIRST_AVAILABLE || siteIds.size() < 2) {
+        return siteIds;
+    }
+    size_t n = siteIds.size();
+    ordered.resize(n);
+    if (policy == ReadPolicy::LEAST_LOCKS) {
+        ranks.resize(n);
+        iota(ranks.begin(), ranks.end(), 0);
+        // ties go to the lower-numbered site
+        stable_sort(ranks.begin(), ranks.end(),
+                    [&](size_t a, size_t b) { return locks[a] < locks[b]; });
+        for (size_t i = 0; i < n; i++) {
+            ordered[i] = siteIds[ranks[i]];
+        }
+        return ordered;
+    }
+    // the other sites keep their order after the first one, so a read still
+    // falls back to the next available replica
+    size_t first = policy == ReadPolicy::ROUND_ROBIN
+                       ? reads++ % n
+                       : uniform_int_distribution<size_t>(0, n - 1)(rng);
+    for (size_t i = 0; i < n; i++) {
+        ordered[i] = siteIds[(first + i) % n];
+    }
+    return ordered;
+}
+
+bool parseReadPolicy(const string& name, ReadPolicy& policy) {
+    for (auto candidate : {ReadPolicy::FIRST_AVAILABLE, ReadPolicy::ROUND_ROBIN,
+                           ReadPolicy::LEAST_LOCKS, ReadPolicy::RANDOM}) {
+        if (name == readPolicyName(candidate)) {
+            policy = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* readPolicyName(const ReadPolicy policy) {
+    switch (policy) {
+        case ReadPolicy::FIRST_AVAILABLE:
+            return "first";
+        case ReadPolicy::ROUND_ROBIN:
+            return "round-robin";
+        case ReadPolicy::LEAST_LOCKS:
+            return "least-locks";
+        case ReadPolicy::RANDOM:
+            return "random";
+    }
+    return "";
+}
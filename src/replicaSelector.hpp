@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "options.hpp"
+
+// Orders the replicas of a variable for a read; the first available one in
+// the order serves it.
+class ReplicaSelector {
+   private:
+    ReadPolicy policy;
+    std::mt19937_64 rng;
+    // reads ordered so far, for ReadPolicy::ROUND_ROBIN
+    size_t reads = 0;
+    std::vector<int> ordered;
+    std::vector<size_t> ranks;
+
+   public:
+    ReplicaSelector(const ReadPolicy policy = ReadPolicy::FIRST_AVAILABLE,
+                    const uint64_t seed = 1)
+        : policy(policy), rng(seed) {}
+    ReadPolicy getPolicy() const { return policy; }
+    // `locks[i]` is the number of locks held at `siteIds[i]`, only needed by
+    // ReadPolicy::LEAST_LOCKS; the result is valid until the next call
+    const std::vector<int>& order(const std::vector<int>& siteIds,
+                                  const std::vector<size_t>& locks = {});
+};
+
+// names used on the command line: first, round-robin, least-locks, random
+bool parseReadPolicy(const std::string& name, ReadPolicy& policy);
+const char* readPolicyName(const ReadPolicy policy);
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+// Double-ended queue over one circular buffer whose capacity doubles when it
+// is full. Slots are reused as elements come and go, so a queue whose length
+// stays bounded stops allocating once it has grown to that length.
+// erase() shifts the elements after the erased ones, which is cheap for the
+// short queues it is used for.
+template <typename T>
+class RingQueue {
+   private:
+    std::unique_ptr<T[]> slots;
+    // a power of two, so positions wrap with a mask
+    size_t capacity = 0;
+    size_t head = 0;
+    size_t count = 0;
+
+    T &slot(const size_t i) { return slots[(head + i) & (capacity - 1)]; }
+    const T &slot(const size_t i) const {
+        return slots[(head + i) & (capacity - 1)];
+    }
+
+    void reserveOneMore() {
+        if (count < capacity) {
+            return;
+        }
+        size_t grown = capacity ? capacity * 2 : 8;
+        std::unique_ptr<T[]> next(new T[grown]);
+        for (size_t i = 0; i < count; i++) {
+            next[i] = std::move(slot(i));
+        }
+        slots = std::move(next);
+        capacity = grown;
+        head = 0;
+    }
+
+    template <bool Const>
+    class Iterator {
+       private:
+        using Queue = std::conditional_t<Const, const RingQueue, RingQueue>;
+        Queue *queue = nullptr;
+        size_t index = 0;
+        friend class RingQueue;
+
+       public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const T *, T *>;
+        using reference = std::conditional_t<Const, const T &, T &>;
+
+        Iterator() = default;
+        Iterator(Queue *queue, const size_t index)
+            : queue(queue), index(index) {}
+        // an iterator converts to a const_iterator
+        template <bool C = Const, typename = std::enable_if_t<C>>
+        Iterator(const Iterator<false> &other)
+            : queue(other.queue), index(other.index) {}
+
+        reference operator*() const { return queue->slot(index); }
+        pointer operator->() const { return &queue->slot(index); }
+        Iterator &operator++() {
+            index++;
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator before = *this;
+            index++;
+            return before;
+        }
+        bool operator==(const Iterator &other) const {
+            return index == other.index;
+        }
+        bool operator!=(const Iterator &other) const {
+            return index != other.index;
+        }
+
+        friend class Iterator<true>;
+    };
+
+   public:
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+
+    T &front() { return slot(0); }
+    const T &front() const { return slot(0); }
+    T &back() { return slot(count - 1); }
+    const T &back() const { return slot(count - 1); }
+
+    void push_back(T value) {
+        reserveOneMore();
+        slot(count) = std::move(value);
+        count++;
+    }
+
+    void push_front(T value) {
+        reserveOneMore();
+        head = (head + capacity - 1) & (capacity - 1);
+        slot(0) = std::move(value);
+        count++;
+    }
+
+    void pop_front() {
+        // release what the element owns now rather than when the slot is
+        // reused
+        slot(0) = T();
+        head = (head + 1) & (capacity - 1);
+        count--;
+    }
+
+    // keeps the buffer for the elements pushed next
+    void clear() {
+        while (count) {
+            pop_front();
+        }
+        head = 0;
+    }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, count); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, count); }
+
+    iterator erase(const_iterator first, const_iterator last) {
+        size_t from = first.index;
+        size_t gap = last.index - first.index;
+        for (size_t i = last.index; i < count; i++) {
+            slot(i - gap) = std::move(slot(i));
+        }
+        for (size_t i = count - gap; i < count; i++) {
+            slot(i) = T();
+        }
+        count -= gap;
+        return iterator(this, from);
+    }
+
+    iterator erase(const_iterator position) {
+        const_iterator next = position;
+        return erase(position, ++next);
+    }
+};
@@ -1,52 +1,254 @@
 #include "site.hpp"
 
-#include <iostream>
+#include <unistd.h>
+
+#include <algorithm>
 #include <string>
+
+#include "checkpoint.hpp"
+#include "output.hpp"
+
 using namespace std;
 
-Site::Site(const int id) : id(id), siteStatus(SiteStatus::UP) { initialize(); }
+Site::Site(const int id, const Topology& topology)
+    : id(id),
+      topology(&topology),
+      lockManager(topology.variablesOf(id)),
+      siteStatus(SiteStatus::UP) {
+    initialize();
+}
 
 void Site::initialize() {
-    // save even indexed variables (replicated variables)
-    for (int i = 2; i <= 20; i += 2) {
-        commitedVal[i] = 10 * i;
+    // save the variables placed on this site
+    for (const auto& i : topology->variablesOf(id)) {
+        versions[i] = VersionChain({0, topology->initialValue(i), true});
     }
+}
 
-    // save odd indexed variables (non-replicated variables)
-    for (int i = 1; i <= 19; i += 2) {
-        if (id == (i % 10) + 1) {
-            commitedVal[i] = 10 * i;
+bool Site::openLog(const Options& options) {
+    string base = options.walDir + "/site" + to_string(id);
+    durability = options.durability;
+    checkpointEvery = options.checkpointEvery;
+    checkpointPath = base + ".ckpt";
+    // a checkpoint left by an earlier run does not match the new log
+    unlink(checkpointPath.c_str());
+    return redoLog.open(base + ".wal", durability, options.groupCommit);
+}
+
+void Site::logWritten(const bool written) const {
+    if (!written) {
+        output().line() << "Error: can not write the redo log of site " << id
+                        << ", its later commits are not logged";
+    }
+}
+
+void Site::writeCheckpoint(const int time) {
+    // the image covers every logged commit, so the log up to its end has to
+    // be written first
+    logWritten(redoLog.flush());
+    if (redoLog.hasFailed()) {
+        return;
+    }
+    vector<pair<Index, Value>> values;
+    for (const auto& i : topology->variablesOf(id)) {
+        values.emplace_back(i, versions.at(i).latest().value);
+    }
+    // on failure the previous checkpoint stays valid
+    checkpoint::write(checkpointPath, values, time, redoLog.size(),
+                      durability);
+    commitsSinceCheckpoint = 0;
+}
+
+bool Site::hasVariable(const Index idx) const { return versions.count(idx); }
+
+bool Site::readVersion(const Index idx, const int time, Value& val) const {
+    auto it = versions.find(idx);
+    if (siteStatus == SiteStatus::DOWN || it == versions.end()) {
+        return false;
+    }
+    auto version = it->second.at(time);
+    if (!version || !version->readable) {
+        return false;
+    }
+    if (topology->isReplicated(idx)) {
+        auto failure =
+            upper_bound(failures.begin(), failures.end(), version->commitTime);
+        if (failure != failures.end() && *failure <= time) {
+            return false;
         }
     }
+    val = version->value;
+    return true;
 }
 
 bool Site::read(const int transactionId, const int idx, int& lockHolder,
                 int& readVal) {
-    if (siteStatus == SiteStatus::DOWN || !commitedVal.count(idx)) {
+    auto it = versions.find(idx);
+    if (siteStatus == SiteStatus::DOWN || it == versions.end()) {
         // site is down or variable does not exit on this site
+        unavailable += it != versions.end();
         return false;
     }
 
-    if (idx % 2 == 0 && restrictedReadVariable.count(idx)) {
+    if (!it->second.latest().readable) {
         // if the site just recovered, we can not read the replicated variables
         // until they are commited
+        unavailable++;
         return false;
     }
 
     // request a ReadLock for read variable
     lockManager.requestRLock(transactionId, idx, lockHolder);
-    readVal = lockHolder == transactionId ? curVal[idx] : commitedVal[idx];
+    if (lockHolder == -1 || lockHolder == transactionId) {
+        reads++;
+    }
+    readVal = lockHolder == transactionId ? curVal[idx]
+                                          : it->second.latest().value;
     return true;
 }
 
+bool Site::readLatest(const Index idx, Value& val) {
+    auto it = versions.find(idx);
+    if (siteStatus == SiteStatus::DOWN || it == versions.end() ||
+        !it->second.latest().readable) {
+        unavailable += it != versions.end();
+        return false;
+    }
+    reads++;
+    val = it->second.latest().value;
+    return true;
+}
+
+void Site::readableIn(const vector<Index>& vars,
+                      vector<Index>& readable) const {
+    if (siteStatus == SiteStatus::DOWN) {
+        return;
+    }
+    for (const auto& idx : vars) {
+        auto it = versions.find(idx);
+        if (it != versions.end() && it->second.latest().readable) {
+            readable.push_back(idx);
+        }
+    }
+}
+
+Index Site::probeReads(const int transactionId, const vector<Index>& vars,
+                       vector<int>& lockHolders) const {
+    Index conflict = 0;
+    for (const auto& idx : vars) {
+        int writer = lockManager.writerOf(idx);
+        if (writer == -1 || writer == transactionId) {
+            continue;
+        }
+        if (!conflict) {
+            conflict = idx;
+        }
+        if (find(lockHolders.begin(), lockHolders.end(), writer) ==
+            lockHolders.end()) {
+            lockHolders.push_back(writer);
+        }
+    }
+    return conflict;
+}
+
+void Site::readBatch(const int transactionId, const vector<Index>& vars,
+                     vector<pair<Index, Value>>& values) {
+    // probeReads() found no conflicting lock, so every request is granted
+    vector<int> lockHolders;
+    if (vars.size() == versions.size()) {
+        lockManager.requestRangeRLock(transactionId, LockManager::wholeSite,
+                                      lockHolders);
+    } else {
+        for (size_t i = 0; i < vars.size();) {
+            int range = LockManager::rangeOf(vars[i]);
+            size_t end = i;
+            while (end < vars.size() &&
+                   LockManager::rangeOf(vars[end]) == range) {
+                end++;
+            }
+            if (end - i == lockManager.variablesIn(range)) {
+                lockManager.requestRangeRLock(transactionId, range,
+                                              lockHolders);
+            } else {
+                for (size_t j = i; j < end; j++) {
+                    int lockHolder = -1;
+                    lockManager.requestRLock(transactionId, vars[j],
+                                             lockHolder);
+                }
+            }
+            i = end;
+        }
+    }
+    for (const auto& idx : vars) {
+        values.emplace_back(idx, lockManager.writerOf(idx) == transactionId
+                                     ? curVal[idx]
+                                     : versions.at(idx).latest().value);
+    }
+    reads += vars.size();
+}
+
+void Site::readLatest(const vector<Index>& vars,
+                      vector<pair<Index, Value>>& values) {
+    vector<Index> readable;
+    readableIn(vars, readable);
+    for (const auto& idx : readable) {
+        values.emplace_back(idx, versions.at(idx).latest().value);
+    }
+    reads += readable.size();
+}
+
+Index Site::probeWrites(const int transactionId,
+                        const vector<pair<Index, Value>>& writes,
+                        vector<Index>& writable,
+                        vector<int>& lockHolders) const {
+    if (siteStatus == SiteStatus::DOWN) {
+        return 0;
+    }
+    Index conflict = 0;
+    vector<int> blockers;
+    for (const auto& [idx, val] : writes) {
+        if (!versions.count(idx) || restrictedWriteVariable.count(idx)) {
+            continue;
+        }
+        writable.push_back(idx);
+        blockers.clear();
+        lockManager.writeBlockers(transactionId, idx, blockers);
+        if (blockers.empty()) {
+            continue;
+        }
+        if (!conflict) {
+            conflict = idx;
+        }
+        for (const auto& holder : blockers) {
+            if (find(lockHolders.begin(), lockHolders.end(), holder) ==
+                lockHolders.end()) {
+                lockHolders.push_back(holder);
+            }
+        }
+    }
+    return conflict;
+}
+
+void Site::writeBatch(const int transactionId,
+                      const vector<pair<Index, Value>>& writes) {
+    // probeWrites() found no conflicting lock, so every request is granted
+    vector<int> lockHolders;
+    for (const auto& [idx, val] : writes) {
+        lockHolders.clear();
+        write(transactionId, idx, val, lockHolders);
+    }
+}
+
 bool Site::write(const int transactionId, const int idx, const int varVal,
-                 unordered_set<int>& lockHolders) {
-    if (siteStatus == SiteStatus::DOWN || !commitedVal.count(idx)) {
+                 vector<int>& lockHolders) {
+    if (siteStatus == SiteStatus::DOWN || !versions.count(idx)) {
         // site is down or variable does not exit on this site
+        unavailable += versions.count(idx);
         return false;
     }
 
     if (restrictedWriteVariable.count(idx)) {
+        unavailable++;
         return false;
     }
 
@@ -54,7 +256,7 @@ bool Site::write(const int transactionId, const int idx, const int varVal,
     lockManager.requestWLock(transactionId, idx, lockHolders);
 
     // if already has a read lock, RLock promotes to WLock
-    if (lockHolders.count(transactionId) && lockHolders.size() == 1) {
+    if (lockHolders.size() == 1 && lockHolders.front() == transactionId) {
         // promote RLock to WLock
         lockManager.promoteLock(transactionId, idx);
         lockHolders.clear();
@@ -62,12 +264,47 @@ bool Site::write(const int transactionId, const int idx, const int varVal,
     if (lockHolders.empty()) {
         // allow to write to curVal
         curVal[idx] = varVal;
+        writes++;
         return true;
     }
 
     return false;
 }
 
+Access Site::probeRead(const int transactionId, const int idx) const {
+    auto it = versions.find(idx);
+    if (siteStatus == SiteStatus::DOWN || it == versions.end() ||
+        !it->second.latest().readable) {
+        return Access::UNAVAILABLE;
+    }
+    return lockManager.canRLock(transactionId, idx) ? Access::GRANTED
+                                                    : Access::BLOCKED;
+}
+
+Access Site::probeWrite(const int transactionId, const int idx) const {
+    if (siteStatus == SiteStatus::DOWN || !versions.count(idx) ||
+        restrictedWriteVariable.count(idx)) {
+        return Access::UNAVAILABLE;
+    }
+    return lockManager.canWLock(transactionId, idx) ? Access::GRANTED
+                                                    : Access::BLOCKED;
+}
+
+SiteMetrics Site::metrics() const {
+    const auto& locks = lockManager.getCounters();
+    SiteMetrics result;
+    result.siteId = id;
+    result.reads = reads;
+    result.writes = writes;
+    result.unavailable = unavailable;
+    result.readLocks = locks.readLocks;
+    result.writeLocks = locks.writeLocks;
+    result.promotions = locks.promotions;
+    result.rangeLocks = locks.rangeLocks;
+    result.conflicts = locks.conflicts;
+    return result;
+}
+
 void Site::abort(const int transactionId) {
     auto modifiedVar = lockManager.releaseLock(transactionId);
     for (const auto& var : modifiedVar) {
@@ -78,74 +315,174 @@ void Site::abort(const int transactionId) {
 }
 
 void Site::commit(const int transactionId,
-                  const unordered_set<int>& affectedVariables) {
+                  const unordered_set<int>& affectedVariables, const int time,
+                  const int horizon) {
     lockManager.releaseLock(transactionId);
+    vector<pair<Index, Value>> writes;
     for (const auto& affectedVar : affectedVariables) {
-        if (curVal.count(affectedVar)) {
-            commitedVal[affectedVar] = curVal[affectedVar];
-            curVal.erase(affectedVar);
-            // if the site just recovered, we need to clean up
-            // restrictedReadVariable to make it readable
-            restrictedReadVariable.erase(affectedVar);
+        auto it = curVal.find(affectedVar);
+        if (it != curVal.end()) {
+            writes.emplace_back(affectedVar, it->second);
+            curVal.erase(it);
         }
         restrictedWriteVariable.erase(affectedVar);
     }
+    apply(writes, time, horizon);
+}
+
+void Site::install(const map<Index, Value>& buffer, const int time,
+                   const int horizon) {
+    vector<pair<Index, Value>> values;
+    for (const auto& [idx, value] : buffer) {
+        if (versions.count(idx)) {
+            values.emplace_back(idx, value);
+            writes++;
+        }
+    }
+    apply(values, time, horizon);
+}
+
+void Site::apply(const vector<pair<Index, Value>>& values, const int time,
+                 const int horizon) {
+    if (values.empty()) {
+        return;
+    }
+    for (const auto& [idx, value] : values) {
+        // the new version is readable even if the site just recovered
+        auto& chain = versions[idx];
+        chain.append({time, value, true});
+        if (chain.collect(horizon)) {
+            multiVersionVariables.insert(idx);
+        }
+    }
+    if (redoLog.isOpen()) {
+        logWritten(redoLog.append(time, values));
+        if (checkpointEvery > 0 &&
+            ++commitsSinceCheckpoint >= checkpointEvery) {
+            writeCheckpoint(time);
+        }
+    }
+}
+
+void Site::collectVersions(const int horizon) {
+    for (auto it = multiVersionVariables.begin();
+         it != multiVersionVariables.end();) {
+        if (versions[*it].collect(horizon)) {
+            it++;
+        } else {
+            it = multiVersionVariables.erase(it);
+        }
+    }
+}
+
+bool Site::canCommit(const pmr::unordered_set<int>& affectedVariables,
+                     const pmr::unordered_map<int, int>& readHistory,
+                     const int time) const {
+    for (const auto& av : affectedVariables) {
+        if (!versions.count(av)) {
+            continue;
+        }
+        // check if there's write operations before this site failed
+        if (restrictedWriteVariable.count(av)) {
+            return false;
+        }
+        if (topology->isReplicated(av)) {
+            // if write time before fail
+            if (siteStatus == SiteStatus::DOWN && curVal.count(av)) {
+                return false;
+            }
+        } else if (siteStatus == SiteStatus::DOWN || !curVal.count(av)) {
+            // non-replicated variable
+            return false;
+        }
+    }
+    for (const auto& e : readHistory) {
+        if (versions.count(e.first) && time < failedTime) {
+            return false;
+        }
+    }
+    return true;
 }
 
 bool Site::fail(int time) {
     if (siteStatus != SiteStatus::UP) {
-        cout << "Site" << id << " is already DOWN!" << endl;
+        output().line() << "Site" << id << " is already DOWN!";
         return false;
     }
+    // the commits of the open group were already reported, so they are
+    // written before the site goes down
+    logWritten(redoLog.flush());
     lockManager.releaseAllLock();
     curVal.clear();
     siteStatus = SiteStatus::DOWN;
     failedTime = time;
+    failures.push_back(time);
     return true;
 }
 
-bool Site::recover() {
+bool Site::recover(int time) {
     if (siteStatus != SiteStatus::DOWN) {
-        cout << "Site" << id << " is already UP!" << endl;
+        output().line() << "Site" << id << " is already UP!";
         return false;
     }
-    // initialize variables
-    initialize();
-
-    // mark rpelicated variables as restricted
-    for (int i = 2; i <= 20; i += 2) {
-        restrictedReadVariable.insert(i);
+    unordered_map<Index, Value> logged;
+    if (redoLog.isOpen()) {
+        vector<pair<Index, Value>> image;
+        uint64_t logOffset = 0;
+        if (checkpoint::load(checkpointPath, image, logOffset)) {
+            logged.insert(image.begin(), image.end());
+        }
+        redoLog.replay(
+            [&](int, const Index idx, const Value value) {
+                logged[idx] = value;
+            },
+            logOffset);
+    }
+    // initialize variables, rpelicated variables stay unreadable until they
+    // are commited
+    for (const auto& i : topology->variablesOf(id)) {
+        auto it = logged.find(i);
+        Value value =
+            it != logged.end() ? it->second : topology->initialValue(i);
+        auto& chain = versions[i];
+        chain.append({time, value, !topology->isReplicated(i)});
+        multiVersionVariables.insert(i);
     }
     siteStatus = SiteStatus::UP;
     return true;
 }
 
-void Site::dumpDebug() {
-    cout << "============" << endl;
-    cout << "Current Val" << endl;
-    cout << "============" << endl;
+void Site::dumpDebug() const {
+    output().line() << "============";
+    output().line() << "Current Val";
+    output().line() << "============";
     string delim = "";
-    cout << "site " << id << " -";
-    for (const auto& [idx, val] : curVal) {
-      cout << delim << " x" << idx << ": " << val;
-      delim = ",";
-    }
-    cout << endl;
-    cout << "============" << endl;
-    cout << "LockTable" << endl;
-    cout << "============" << endl;
+    {
+        auto line = output().line();
+        line << "site " << id << " -";
+        for (const auto& [idx, val] : curVal) {
+            line << delim << " x" << idx << ": " << val;
+            delim = ",";
+        }
+    }
+    output().line() << "============";
+    output().line() << "LockTable";
+    output().line() << "============";
     lockManager.dump();
-    cout << endl;
+    output().line();
 }
 
 void Site::dump() const {
-    string delim = "";
-    cout << "Site " << id << " -";
-    for (const auto& v : commitedVal) {
-        cout << delim << " x" << v.first << ": " << v.second;
-        delim = ",";
+    {
+        string delim = "";
+        auto line = output().line();
+        line << "Site " << id << " -";
+        for (const auto& i : topology->variablesOf(id)) {
+            line << delim << " x" << i << ": "
+                 << versions.at(i).latest().value;
+            delim = ",";
+        }
     }
-    cout << endl;
 
 #ifdef DEBUG
     dumpDebug();
@@ -1,44 +1,131 @@
 #pragma once
 #include <iostream>
 #include <map>
+#include <memory_resource>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "lockManager.hpp"
+#include "metrics.hpp"
+#include "options.hpp"
+#include "redoLog.hpp"
+#include "topology.hpp"
+#include "versionChain.hpp"
 using namespace std;
 
-using Index = int;
-using Value = int;
-
 enum class SiteStatus { UP = 1, DOWN };
+// what a read or write would get from a site right now
+enum class Access { UNAVAILABLE = 1, GRANTED, BLOCKED };
 
 class Site {
    private:
     int id;
+    const Topology* topology = nullptr;
     LockManager lockManager;
+    // variables currently keeping more than one version
+    unordered_set<Index> multiVersionVariables;
+    // commits made durable on this site, closed when logging is off
+    RedoLog redoLog;
+    Durability durability = Durability::FSYNC;
+    string checkpointPath;
+    int checkpointEvery = 0;
+    int commitsSinceCheckpoint = 0;
+    // reads and writes granted, requests turned away while unavailable
+    long long reads = 0;
+    long long writes = 0;
+    long long unavailable = 0;
+    // times this site failed, ascending
+    vector<int> failures;
+
+    void writeCheckpoint(const int time);
+    // reports a redo log write that failed
+    void logWritten(const bool written) const;
+    // appends the committed values as new versions and logs them
+    void apply(const vector<pair<Index, Value>>& values, const int time,
+               const int horizon);
 
    public:
     int failedTime = 0;
     SiteStatus siteStatus;
-    map<Index, Value> commitedVal;
+    // committed versions of every variable stored on this site
+    unordered_map<Index, VersionChain> versions;
     map<Index, Value> curVal;
-    unordered_set<int> restrictedReadVariable;
     unordered_set<int> restrictedWriteVariable;
     Site() {}
-    Site(const int id);
+    Site(const int id, const Topology& topology);
     void initialize();
+    // starts logging the commits to `<dir>/site<id>.wal` and checkpointing
+    // to `<dir>/site<id>.ckpt`
+    bool openLog(const Options& options);
+    void closeLog() { logWritten(redoLog.close()); }
+    const RedoLog& log() const { return redoLog; }
+    bool hasVariable(const Index idx) const;
+    // committed value visible to a snapshot taken at `time`; a replicated
+    // variable is not read from a site that failed between the commit of that
+    // value and the snapshot, as it may have missed a newer one
+    bool readVersion(const Index idx, const int time, Value& val) const;
 
     bool read(const int transactionId, const int idx, int& lockHolder,
               int& readVal);
+    // the latest committed value, without taking a lock
+    bool readLatest(const Index idx, Value& val);
+
+    // the variables of `vars`, ascending, a read could be served from here
+    // right now
+    void readableIn(const vector<Index>& vars, vector<Index>& readable) const;
+    // the transactions holding X locks on `vars`, and the first variable one
+    // of them holds, 0 if reading `vars` would be granted
+    Index probeReads(const int transactionId, const vector<Index>& vars,
+                     vector<int>& lockHolders) const;
+    // read-locks `vars`, as found readable by readableIn(), in ascending
+    // order and reads them; one S lock covers the site or a range when
+    // `vars` hold all of its variables
+    void readBatch(const int transactionId, const vector<Index>& vars,
+                   vector<pair<Index, Value>>& values);
+    // lock-free batch read of the latest committed values
+    void readLatest(const vector<Index>& vars,
+                    vector<pair<Index, Value>>& values);
+    // the variables of `writes` a write would go to here, the other
+    // transactions holding locks on them, and the first such variable, 0 if
+    // none
+    Index probeWrites(const int transactionId,
+                      const vector<pair<Index, Value>>& writes,
+                      vector<Index>& writable, vector<int>& lockHolders) const;
+    // write-locks the variables probeWrites() found writable, in ascending
+    // order, and writes them
+    void writeBatch(const int transactionId,
+                    const vector<pair<Index, Value>>& writes);
     bool write(const int transactionId, const int idx, const int varVal,
-               unordered_set<int>& lockHolders);
+               vector<int>& lockHolders);
+    // same outcome as read() and write(), without taking any lock
+    Access probeRead(const int transactionId, const int idx) const;
+    Access probeWrite(const int transactionId, const int idx) const;
+    size_t lockCount() const { return lockManager.lockCount(); }
+    SiteMetrics metrics() const;
     // release lock from this transaction and
     // rollback if the value is modified.
     void abort(const int transactionId);
+    // stamps the new versions with `time` and drops the ones older than
+    // `horizon`, the start of the oldest active snapshot
     void commit(const int transactionId,
-                const unordered_set<int>& affectedVariables);
+                const unordered_set<int>& affectedVariables, const int time,
+                const int horizon);
+    // commits the buffered writes of a transaction, those of variables this
+    // site stores
+    void install(const map<Index, Value>& buffer, const int time,
+                 const int horizon);
+    void collectVersions(const int horizon);
+    // whether the writes and reads of a transaction on this site survived
+    // until its commit
+    bool canCommit(const pmr::unordered_set<int>& affectedVariables,
+                   const pmr::unordered_map<int, int>& readHistory,
+                   const int time) const;
     bool fail(int time);
-    bool recover();
-    void dumpDebug();
+    // with a redo log the variables get back their last committed values,
+    // read from the latest checkpoint and the log written after it, otherwise
+    // their initial ones
+    bool recover(int time);
+    void dumpDebug() const;
     void dump() const;
 
     friend ostream& operator<<(ostream& os, const SiteStatus& siteSatus);
@@ -0,0 +1,87 @@
+#include "sitePool.hpp"
+
+#include "output.hpp"
+
+using namespace std;
+
+SiteWorker::SiteWorker() : thread([this] { run(); }) {}
+
+SiteWorker::~SiteWorker() {
+    {
+        lock_guard<mutex> lock(mtx);
+        stopping = true;
+    }
+    hasWork.notify_one();
+    thread.join();
+}
+
+void SiteWorker::post(function<void()> request) {
+    {
+        lock_guard<mutex> lock(mtx);
+        requests.push_back(move(request));
+    }
+    hasWork.notify_one();
+}
+
+void SiteWorker::run() {
+    while (true) {
+        function<void()> request;
+        {
+            unique_lock<mutex> lock(mtx);
+            hasWork.wait(lock, [this] { return stopping || !requests.empty(); });
+            if (requests.empty()) {
+                return;
+            }
+            request = move(requests.front());
+            requests.pop_front();
+        }
+        request();
+    }
+}
+
+void Completion::done() {
+    lock_guard<mutex> lock(mtx);
+    if (--pending == 0) {
+        finished.notify_one();
+    }
+}
+
+void Completion::wait() {
+    unique_lock<mutex> lock(mtx);
+    finished.wait(lock, [this] { return pending == 0; });
+}
+
+void SitePool::start(const Topology &topology, const Options &options) {
+    stop();
+    sites.clear();
+    for (int i = 0; i < topology.siteCount(); i++) {
+        sites.emplace_back(Site(i + 1, topology));
+        if (!options.walDir.empty() && !sites.back().openLog(options)) {
+            output().line() << "Error: can not open the redo log of site "
+                            << i + 1 << " in " << options.walDir;
+        }
+    }
+    for (int i = 0; i < min(options.siteThreads, topology.siteCount());
+         i++) {
+        workers.push_back(make_unique<SiteWorker>());
+    }
+}
+
+void SitePool::stop() {
+    drain();
+    workers.clear();
+    for (auto &site : sites) {
+        site.closeLog();
+    }
+}
+
+void SitePool::drain() {
+    if (workers.empty()) {
+        return;
+    }
+    Completion completion(workers.size());
+    for (auto &worker : workers) {
+        worker->post([&] { completion.done(); });
+    }
+    completion.wait();
+}
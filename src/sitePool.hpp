@@ -0,0 +1,147 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "options.hpp"
+#include "site.hpp"
+#include "topology.hpp"
+
+// A thread with a FIFO queue of requests for the sites it owns.
+class SiteWorker {
+   private:
+    std::mutex mtx;
+    std::condition_variable hasWork;
+    std::deque<std::function<void()>> requests;
+    bool stopping = false;
+    std::thread thread;
+
+    void run();
+
+   public:
+    SiteWorker();
+    ~SiteWorker();
+    void post(std::function<void()> request);
+};
+
+// Counts down the replies of a fan-out.
+class Completion {
+   private:
+    std::mutex mtx;
+    std::condition_variable finished;
+    int pending;
+
+   public:
+    Completion(const int pending) : pending(pending) {}
+    void done();
+    void wait();
+};
+
+// Owns the sites. With no worker threads every request runs inline on the
+// caller; otherwise site i is owned by worker (i - 1) % threads and all
+// requests to it go through that worker's queue, so requests to one site
+// are applied in the order they were sent.
+class SitePool {
+   private:
+    std::vector<Site> sites;
+    std::vector<std::unique_ptr<SiteWorker>> workers;
+
+    SiteWorker &workerOf(const int siteId) {
+        return *workers[(siteId - 1) % workers.size()];
+    }
+
+   public:
+    // creates the sites, their redo logs and the workers
+    void start(const Topology &topology, const Options &options);
+    void stop();
+    int size() const { return sites.size(); }
+
+    // runs `fn(site)` on the site's worker and waits for its result
+    template <typename F>
+    auto call(const int siteId, F &&fn) -> decltype(fn(sites[0])) {
+        Site &site = sites[siteId - 1];
+        if (workers.empty()) {
+            return fn(site);
+        }
+        Completion completion(1);
+        if constexpr (std::is_void_v<decltype(fn(site))>) {
+            workerOf(siteId).post([&] {
+                fn(site);
+                completion.done();
+            });
+            completion.wait();
+        } else {
+            decltype(fn(site)) result{};
+            workerOf(siteId).post([&] {
+                result = fn(site);
+                completion.done();
+            });
+            completion.wait();
+            return result;
+        }
+    }
+
+    // runs `fn(site, i)` for the i-th listed site concurrently and waits
+    // for all of them
+    template <typename F>
+    void forEach(const std::vector<int> &siteIds, F &&fn) {
+        if (workers.empty()) {
+            for (size_t i = 0; i < siteIds.size(); i++) {
+                fn(sites[siteIds[i] - 1], i);
+            }
+            return;
+        }
+        Completion completion(siteIds.size());
+        for (size_t i = 0; i < siteIds.size(); i++) {
+            Site &site = sites[siteIds[i] - 1];
+            workerOf(siteIds[i]).post([&, i] {
+                fn(site, i);
+                completion.done();
+            });
+        }
+        completion.wait();
+    }
+
+    // runs `fn(site)` on every site and waits for all of them
+    template <typename F>
+    void forAll(F &&fn) {
+        if (workers.empty()) {
+            for (auto &site : sites) {
+                fn(site);
+            }
+            return;
+        }
+        Completion completion(sites.size());
+        for (int siteId = 1; siteId <= size(); siteId++) {
+            Site &site = sites[siteId - 1];
+            workerOf(siteId).post([&] {
+                fn(site);
+                completion.done();
+            });
+        }
+        completion.wait();
+    }
+
+    // queues `fn(site)` on every site without waiting; `fn` is copied and
+    // must own everything it refers to
+    template <typename F>
+    void postAll(const F &fn) {
+        if (workers.empty()) {
+            forAll(fn);
+            return;
+        }
+        for (int siteId = 1; siteId <= size(); siteId++) {
+            Site &site = sites[siteId - 1];
+            workerOf(siteId).post([fn, &site] { fn(site); });
+        }
+    }
+
+    // waits until every queued request has been applied
+    void drain();
+};
@@ -0,0 +1,144 @@
+#include "topology.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+namespace {
+const vector<int> noSites;
+const vector<Index> noVariables;
+}  // namespace
+
+Topology::Topology() : Topology(10, 20) {}
+
+Topology::Topology(const int numSites, const int numVariables,
+                   const int replicas)
+    : numSites(numSites), numVariables(numVariables) {
+    build(replicas);
+}
+
+void Topology::build(const int replicas) {
+    placement.assign(numVariables + 1, {});
+    replicated.assign(numVariables + 1, false);
+    int copies = replicas <= 0 ? numSites : min(replicas, numSites);
+    for (int i = 1; i <= numVariables; i++) {
+        int home = (i % numSites) + 1;
+        if (i % 2 == 0) {
+            // replicated variables, unless there is a single copy of each
+            for (int k = 0; k < copies; k++) {
+                placement[i].push_back((home - 1 + k) % numSites + 1);
+            }
+            sort(placement[i].begin(), placement[i].end());
+            replicated[i] = placement[i].size() > 1;
+        } else {
+            // non-replicated variables
+            placement[i].push_back(home);
+        }
+    }
+    indexSites();
+}
+
+void Topology::indexSites() {
+    siteVariables.assign(numSites + 1, {});
+    for (int i = 1; i <= numVariables; i++) {
+        for (const auto &siteId : placement[i]) {
+            siteVariables[siteId].push_back(i);
+        }
+    }
+}
+
+void Topology::place(const Index idx, vector<int> siteIds) {
+    sort(siteIds.begin(), siteIds.end());
+    siteIds.erase(unique(siteIds.begin(), siteIds.end()), siteIds.end());
+    replicated[idx] = siteIds.size() > 1;
+    placement[idx] = move(siteIds);
+}
+
+bool Topology::load(const string &filename, Topology &topology,
+                    string &error) {
+    ifstream infile(filename);
+    if (!infile) {
+        error = "can not open topology file " + filename;
+        return false;
+    }
+
+    int sites = 10, variables = 20, replicas = 0;
+    vector<pair<Index, vector<int>>> explicitPlacement;
+    string line;
+    int lineNo = 0;
+    while (getline(infile, line)) {
+        lineNo++;
+        istringstream in(line);
+        string key;
+        if (!(in >> key) || key[0] == '#' || key.rfind("//", 0) == 0) {
+            continue;
+        }
+        bool ok = true;
+        if (key == "sites") {
+            ok = static_cast<bool>(in >> sites) && sites > 0;
+        } else if (key == "variables") {
+            ok = static_cast<bool>(in >> variables) && variables > 0;
+        } else if (key == "replicas") {
+            ok = static_cast<bool>(in >> replicas) && replicas >= 0;
+        } else if (key[0] == 'x') {
+            Index idx = atoi(key.c_str() + 1);
+            vector<int> siteIds;
+            int siteId;
+            while (in >> siteId) {
+                siteIds.push_back(siteId);
+            }
+            ok = idx > 0 && !siteIds.empty();
+            explicitPlacement.emplace_back(idx, siteIds);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            error = filename + ":" + to_string(lineNo) + ": bad line '" +
+                    line + "'";
+            return false;
+        }
+    }
+
+    Topology result(sites, variables, replicas);
+    for (auto &[idx, siteIds] : explicitPlacement) {
+        if (idx > variables) {
+            error = "x" + to_string(idx) + " is out of range";
+            return false;
+        }
+        for (const auto &siteId : siteIds) {
+            if (siteId < 1 || siteId > sites) {
+                error = "x" + to_string(idx) + " is placed on unknown site " +
+                        to_string(siteId);
+                return false;
+            }
+        }
+        result.place(idx, siteIds);
+    }
+    result.indexSites();
+    topology = move(result);
+    return true;
+}
+
+bool Topology::hasVariable(const Index idx) const {
+    return idx > 0 && idx <= numVariables;
+}
+
+bool Topology::isReplicated(const Index idx) const {
+    return hasVariable(idx) && replicated[idx];
+}
+
+const vector<int> &Topology::sitesOf(const Index idx) const {
+    return hasVariable(idx) ? placement[idx] : noSites;
+}
+
+bool Topology::isStoredOn(const Index idx, const int siteId) const {
+    const auto &siteIds = sitesOf(idx);
+    return binary_search(siteIds.begin(), siteIds.end(), siteId);
+}
+
+const vector<Index> &Topology::variablesOf(const int siteId) const {
+    return siteId > 0 && siteId <= numSites ? siteVariables[siteId]
+                                            : noVariables;
+}
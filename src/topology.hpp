@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+using Index = int;
+using Value = int;
+
+// Number of sites and variables and the placement of every variable. All
+// components look up "which sites hold x" and "what does site s store" here.
+//
+// Without an explicit placement, variable i is stored on site (i % N) + 1
+// when odd, and replicated when even (on every site, or on `replicas`
+// consecutive sites starting there). This is the 10 site, 20 variable model
+// by default.
+class Topology {
+   private:
+    int numSites;
+    int numVariables;
+    // placement[varIdx] -> ascending ids of the sites holding the variable
+    std::vector<std::vector<int>> placement;
+    // siteVariables[siteId] -> ascending variables stored on the site
+    std::vector<std::vector<Index>> siteVariables;
+    std::vector<bool> replicated;
+
+    void build(const int replicas);
+    void indexSites();
+    // moves a variable to the given sites; it counts as replicated when it
+    // is stored on more than one site (call indexSites() afterwards)
+    void place(const Index idx, std::vector<int> siteIds);
+
+   public:
+    Topology();
+    Topology(const int numSites, const int numVariables,
+             const int replicas = 0);
+
+    // Reads a topology file:
+    //   sites <N>
+    //   variables <M>
+    //   replicas <K>          (optional, 0 means every site)
+    //   x<i> <site> <site>... (optional explicit placement)
+    // Blank lines and lines starting with '#' or '//' are skipped.
+    static bool load(const std::string &filename, Topology &topology,
+                     std::string &error);
+
+    int siteCount() const { return numSites; }
+    int variableCount() const { return numVariables; }
+    bool hasVariable(const Index idx) const;
+    bool isReplicated(const Index idx) const;
+    const std::vector<int> &sitesOf(const Index idx) const;
+    bool isStoredOn(const Index idx, const int siteId) const;
+    const std::vector<Index> &variablesOf(const int siteId) const;
+    Value initialValue(const Index idx) const { return 10 * idx; }
+};
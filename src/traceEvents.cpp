@@ -0,0 +1,67 @@
+#include "traceEvents.hpp"
+
+using namespace std;
+
+bool TraceEventWriter::open(const string &path) {
+    out.open(path);
+    if (!out) {
+        return false;
+    }
+    out << "{\"otherData\": {\"clock\": \"logical time\"}, \"traceEvents\": [";
+    first = true;
+    openSpans.clear();
+    nameTrack(transactions, 0, "transactions");
+    nameTrack(sites, 0, "sites");
+    return true;
+}
+
+bool TraceEventWriter::close() {
+    if (!out.is_open()) {
+        return true;
+    }
+    out << "\n]}\n";
+    out.close();
+    return !out.fail();
+}
+
+void TraceEventWriter::event(const char *phase, string_view name,
+                             const int pid, const int tid, const int ts,
+                             string_view args, string_view extra) {
+    out << (first ? "\n" : ",\n") << "{\"name\": \"" << name
+        << "\", \"ph\": \"" << phase << "\", \"ts\": " << ts
+        << ", \"pid\": " << pid << ", \"tid\": " << tid << extra;
+    if (!args.empty()) {
+        out << ", \"args\": " << args;
+    }
+    out << "}";
+    first = false;
+}
+
+void TraceEventWriter::nameTrack(const int pid, const int tid,
+                                 string_view name) {
+    string args = "{\"name\": \"" + string(name) + "\"}";
+    // tid 0 names the process
+    event("M", tid ? "thread_name" : "process_name", pid, tid, 0, args);
+}
+
+void TraceEventWriter::begin(const int ts, const int tid, string_view name,
+                             string_view args) {
+    openSpans[tid]++;
+    event("B", name, transactions, tid, ts, args);
+}
+
+void TraceEventWriter::end(const int ts, const int tid, string_view args) {
+    auto spans = openSpans.find(tid);
+    if (spans == openSpans.end()) {
+        return;
+    }
+    if (--spans->second == 0) {
+        openSpans.erase(spans);
+    }
+    event("E", "", transactions, tid, ts, args);
+}
+
+void TraceEventWriter::instant(const int ts, const int pid, const int tid,
+                               string_view name, string_view args) {
+    event("i", name, pid, tid, ts, args, ", \"s\": \"t\"");
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Writes events in the Chrome trace event format, readable by
+// chrome://tracing and Perfetto. Timestamps are the simulator's logical
+// time, one tick shown as one microsecond. `args` is the text of a JSON
+// object, or empty.
+class TraceEventWriter {
+   public:
+    // processes grouping the tracks
+    static constexpr int transactions = 1;
+    static constexpr int sites = 2;
+
+   private:
+    std::ofstream out;
+    bool first = true;
+    // spans open on each track of `transactions`
+    std::unordered_map<int, int> openSpans;
+
+    void event(const char *phase, std::string_view name, const int pid,
+               const int tid, const int ts, std::string_view args,
+               std::string_view extra = {});
+
+   public:
+    bool open(const std::string &path);
+    // writes the end of the document; false if anything failed to write
+    bool close();
+    void nameTrack(const int pid, const int tid, std::string_view name);
+    // opens a span on the track of a transaction
+    void begin(const int ts, const int tid, std::string_view name,
+               std::string_view args = {});
+    // closes the innermost open span of the track, if there is one
+    void end(const int ts, const int tid, std::string_view args = {});
+    void instant(const int ts, const int pid, const int tid,
+                 std::string_view name, std::string_view args = {});
+};
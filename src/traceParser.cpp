@@ -0,0 +1,240 @@
+#include "traceParser.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+struct Argument {
+    char prefix;  // 'T', 'x' or 0 for a plain number
+    int value;
+};
+
+bool isBlank(const char c) { return c == ' ' || c == '\t' || c == '\r'; }
+bool isLetter(const char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+bool isDigit(const char c) { return c >= '0' && c <= '9'; }
+
+// checks the arguments against a pattern such as "Tx0"
+bool matches(const Argument *args, const int count, const char *pattern) {
+    int i = 0;
+    for (; pattern[i]; i++) {
+        char prefix = pattern[i] == '0' ? 0 : pattern[i];
+        if (i >= count || args[i].prefix != prefix) {
+            return false;
+        }
+    }
+    return i == count;
+}
+
+// reads a decimal number, with a leading '-' if `allowNegative`
+bool parseNumber(const char *&p, const char *end, const bool allowNegative,
+                 const int argument, int &value, string &error) {
+    bool negative = false;
+    if (allowNegative && p < end && *p == '-') {
+        negative = true;
+        p++;
+    }
+    if (p == end || !isDigit(*p)) {
+        error = "expected a number in argument " + to_string(argument);
+        return false;
+    }
+    long long number = 0;
+    while (p < end && isDigit(*p)) {
+        number = number * 10 + (*p++ - '0');
+        if (number > INT_MAX) {
+            error = "number out of range in argument " + to_string(argument);
+            return false;
+        }
+    }
+    value = negative ? -number : number;
+    return true;
+}
+
+}  // namespace
+
+TraceParser::Result TraceParser::parseLine(string_view line,
+                                           Operation &operation,
+                                           string &error) {
+    const char *p = line.data();
+    const char *end = p + line.size();
+    while (p < end && isBlank(*p)) {
+        p++;
+    }
+    if (p == end || !isLetter(*p)) {
+        return Result::SKIP;
+    }
+
+    const char *nameBegin = p;
+    while (p < end && isLetter(*p)) {
+        p++;
+    }
+    string_view name(nameBegin, p - nameBegin);
+    while (p < end && isBlank(*p)) {
+        p++;
+    }
+    if (p == end || *p != '(') {
+        error = "expected '(' after '" + string(name) + "'";
+        return Result::ERROR;
+    }
+    p++;
+
+    // MR(T1,x1,x2,...) and MW(T1,x1=5,x2=-3,...) take any number of
+    // variables
+    bool isBatch = name == "MR" || name == "MW";
+    vector<pair<int, int>> batch;
+    Argument args[3];
+    int count = 0;
+    while (true) {
+        while (p < end && (isBlank(*p) || *p == ',')) {
+            p++;
+        }
+        if (p == end) {
+            error = "missing ')'";
+            return Result::ERROR;
+        }
+        if (*p == ')') {
+            p++;
+            break;
+        }
+        if (count == 3 && !isBatch) {
+            error = "too many arguments";
+            return Result::ERROR;
+        }
+        Argument arg;
+        arg.prefix = 0;
+        if (*p == 'T' || *p == 'x') {
+            arg.prefix = *p++;
+        }
+        count++;
+        if (!parseNumber(p, end, !arg.prefix, count, arg.value, error)) {
+            return Result::ERROR;
+        }
+        if (isBatch && count > 1) {
+            if (arg.prefix != 'x') {
+                error = "expected a variable in argument " + to_string(count);
+                return Result::ERROR;
+            }
+            int value = -1;
+            if (name == "MW") {
+                if (p == end || *p != '=') {
+                    error = "expected '=' in argument " + to_string(count);
+                    return Result::ERROR;
+                }
+                p++;
+                if (!parseNumber(p, end, true, count, value, error)) {
+                    return Result::ERROR;
+                }
+            }
+            batch.emplace_back(arg.value, value);
+            continue;
+        }
+        args[count - 1] = arg;
+    }
+
+    // only blanks or a trailing comment may follow
+    while (p < end && isBlank(*p)) {
+        p++;
+    }
+    if (p != end && !(end - p >= 2 && p[0] == '/' && p[1] == '/')) {
+        error = "unexpected text after ')'";
+        return Result::ERROR;
+    }
+
+    operation = Operation();
+    if (name == "R" && matches(args, count, "Tx")) {
+        // R(T3,x4)
+        operation.action = Action::READ;
+    } else if (name == "W" && matches(args, count, "Tx0")) {
+        // W(T1,x1,100)
+        operation.action = Action::WRITE;
+        operation.val = args[2].value;
+    } else if (name == "RS" && matches(args, count, "Txx")) {
+        // RS(T2,x1,x20) reads x1 through x20
+        if (args[2].value < args[1].value) {
+            error = "empty range";
+            return Result::ERROR;
+        }
+        operation.action = Action::SCAN;
+        operation.val = args[2].value;
+    } else if (isBatch && count > 1 && args[0].prefix == 'T') {
+        // the variables in the order their locks are taken
+        sort(batch.begin(), batch.end());
+        for (size_t i = 1; i < batch.size(); i++) {
+            if (batch[i].first == batch[i - 1].first) {
+                error = "x" + to_string(batch[i].first) + " appears twice";
+                return Result::ERROR;
+            }
+        }
+        operation.action = name == "MR" ? Action::MREAD : Action::MWRITE;
+        operation.varIdx = batch.front().first;
+        operation.batch = move(batch);
+    } else if (name == "begin" && matches(args, count, "T")) {
+        operation.action = Action::BEGIN;
+    } else if (name == "beginRO" && matches(args, count, "T")) {
+        operation.action = Action::BEGINRO;
+    } else if (name == "end" && matches(args, count, "T")) {
+        operation.action = Action::END;
+    } else if (name == "dump" && matches(args, count, "")) {
+        operation.action = Action::DUMP;
+    } else if (name == "stats" && matches(args, count, "")) {
+        operation.action = Action::STATS;
+    } else if (name == "fail" && matches(args, count, "0")) {
+        operation.action = Action::FAIL;
+        operation.siteId = args[0].value;
+    } else if (name == "recover" && matches(args, count, "0")) {
+        operation.action = Action::RECOVER;
+        operation.siteId = args[0].value;
+    } else {
+        error = "wrong operation '" + string(name) + "'";
+        return Result::ERROR;
+    }
+    if (count > 0 && args[0].prefix == 'T') {
+        operation.transactionId = args[0].value;
+    }
+    if (count > 1 && !isBatch && args[1].prefix == 'x') {
+        operation.varIdx = args[1].value;
+    }
+    return Result::OPERATION;
+}
+
+MappedFile::~MappedFile() {
+    if (base) {
+        munmap(const_cast<char *>(base), length);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+bool MappedFile::open(const char *filename) {
+    fd = ::open(filename, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    length = st.st_size;
+    if (length == 0) {
+        return true;
+    }
+    void *addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+        length = 0;
+        return false;
+    }
+    madvise(addr, length, MADV_SEQUENTIAL);
+    base = static_cast<const char *>(addr);
+    return true;
+}
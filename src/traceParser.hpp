@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "operation.hpp"
+
+// Parses one trace line such as `W(T1,x2,-5) // comment` in a single pass.
+// Arguments may be separated by commas and/or blanks; the values of a batch
+// write follow their variable, as in `MW(T1, x2=5, x4=-1)`.
+class TraceParser {
+   public:
+    enum class Result { OPERATION, SKIP, ERROR };
+
+    // SKIP for blank lines and lines not starting with a letter (comments)
+    static Result parseLine(std::string_view line, Operation &operation,
+                            std::string &error);
+};
+
+// Read-only memory mapping of a regular file.
+class MappedFile {
+   private:
+    const char *base = nullptr;
+    size_t length = 0;
+    int fd = -1;
+
+   public:
+    MappedFile() {}
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile();
+
+    // false if the file can not be opened or is not a regular file
+    bool open(const char *filename);
+    std::string_view data() const { return {base, length}; }
+};
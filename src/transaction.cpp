@@ -2,13 +2,27 @@
 
 using namespace std;
 
+namespace {
+
+pmr::memory_resource *resourceOf(Arena *arena) {
+    return arena ? arena : pmr::get_default_resource();
+}
+
+}  // namespace
+
 Transaction::Transaction(){};
 Transaction::Transaction(const int id, const int startTime,
-                         const bool isReadOnly)
+                         const bool isReadOnly, Arena *arena)
     : id(id),
       startTime(startTime),
       isReadOnly(isReadOnly),
-      transactionStatus(TransactionStatus::RUNNING){};
+      transactionStatus(TransactionStatus::RUNNING),
+      arena(arena),
+      affectedVariables(resourceOf(arena)),
+      readHistory(resourceOf(arena)),
+      writeHistory(resourceOf(arena)),
+      readVersions(resourceOf(arena)),
+      writeBuffer(resourceOf(arena)){};
 
 ostream &operator<<(ostream &os, const TransactionStatus &transactionStatus) {
     switch (transactionStatus) {
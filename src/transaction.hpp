@@ -2,9 +2,12 @@
 
 #include <iostream>
 #include <map>
+#include <memory_resource>
 #include <unordered_map>
 #include <unordered_set>
 
+#include "arena.hpp"
+
 using Index = int;
 using Value = int;
 
@@ -13,18 +16,34 @@ enum class TransactionStatus { RUNNING = 1, WAITING, ABORTED, COMMITED };
 class Transaction {
    public:
     Transaction();
-    Transaction(const int id, const int startTime, const bool isReadOnly);
+    // the containers allocate from `arena`, which the transaction manager
+    // frees when the transaction ends
+    Transaction(const int id, const int startTime, const bool isReadOnly,
+                Arena *arena = nullptr);
     int id;
     int startTime;
     bool isReadOnly;
     TransactionStatus transactionStatus;
-    std::unordered_set<int> affectedVariables;
+    Arena *arena = nullptr;
+    std::pmr::unordered_set<int> affectedVariables;
+
+    std::pmr::unordered_map<int, int> readHistory;
+    std::pmr::unordered_map<int, int> writeHistory;
 
-    std::unordered_map<int, int> readHistory;
-    std::unordered_map<int, int> writeHistory;
+    // engines other than Engine::LOCKING: the version of each variable the
+    // first read saw, its commit time under Engine::OPTIMISTIC and the
+    // snapshot time otherwise, and the values written, installed at commit
+    std::pmr::unordered_map<int, int> readVersions;
+    std::pmr::map<Index, Value> writeBuffer;
+    int commitTime = -1;
+    // Engine::SERIALIZABLE_SNAPSHOT: a concurrent transaction read a version
+    // this one overwrote (in), or overwrote a version it read (out)
+    bool inConflict = false;
+    bool outConflict = false;
 
-    // for read-only transaction
-    std::map<Index, Value> commitedValCopy;
+    // for read-only transaction, the time of the snapshot it reads;
+    // -1 once the snapshot is released
+    int snapshotTime = -1;
 
     friend std::ostream &operator<<(std::ostream &os,
                                     const TransactionStatus &transactionStatus);
@@ -34,3 +53,13 @@ class Transaction {
 std::ostream &operator<<(std::ostream &os,
                          const TransactionStatus &transactionStatus);
 std::ostream &operator<<(std::ostream &os, const Transaction tran);
+
+// What is kept of a transaction after it ended: an aborted one until its
+// end() reports the abort, a committed one while a running transaction may
+// still be concurrent with it.
+struct Tombstone {
+    TransactionStatus transactionStatus;
+    int commitTime = -1;
+    bool inConflict = false;
+    bool outConflict = false;
+};
@@ -1,318 +1,1262 @@
 #include "transactionManager.hpp"
 
 #include <algorithm>
+#include <chrono>
+#include <memory>
+#include <sstream>
 #include <unordered_set>
 
+#include "output.hpp"
+
 using namespace std;
 
 namespace {
 
-bool dfs(unordered_map<int, list<int>> &waitForGraph,
-         unordered_set<int> &visited, int curNode, list<int> &path) {
-    path.push_back(curNode);
-    if (visited.count(curNode)) {
-        // find cycle
-        return true;
+const pmr::unordered_set<int> noWrites;
+
+// requests on several variables, granted all at once
+bool isBatch(const Operation &operation) {
+    return operation.action == Action::SCAN ||
+           operation.action == Action::MREAD ||
+           operation.action == Action::MWRITE;
+}
+
+bool writes(const Operation &operation) {
+    return operation.action == Action::WRITE ||
+           operation.action == Action::MWRITE;
+}
+
+// whether a granted request locks the variable
+bool holds(const Operation &operation, const int varIdx) {
+    if (operation.action == Action::SCAN) {
+        return varIdx >= operation.varIdx && varIdx <= operation.val;
     }
-    if (!waitForGraph.count(curNode)) {
-        return false;
+    if (operation.batch.empty()) {
+        return varIdx == operation.varIdx;
     }
-    visited.insert(curNode);
-    for (auto &next : waitForGraph[curNode]) {
-        if (dfs(waitForGraph, visited, next, path)) {
-            return true;
-        }
+    return binary_search(operation.batch.begin(), operation.batch.end(),
+                         make_pair(varIdx, 0),
+                         [](const pair<int, int> &a, const pair<int, int> &b) {
+                             return a.first < b.first;
+                         });
+}
+
+string traceName(const Operation &operation) {
+    switch (operation.action) {
+        case Action::WRITE:
+            return "W x" + to_string(operation.varIdx);
+        case Action::SCAN:
+            return "RS x" + to_string(operation.varIdx) + "-x" +
+                   to_string(operation.val);
+        case Action::MREAD:
+            return "MR x" + to_string(operation.varIdx) + "+" +
+                   to_string(operation.batch.size() - 1);
+        case Action::MWRITE:
+            return "MW x" + to_string(operation.varIdx) + "+" +
+                   to_string(operation.batch.size() - 1);
+        default:
+            return "R x" + to_string(operation.varIdx);
     }
-    path.pop_back();
-    return false;
 }
 
-bool hasCycle(unordered_map<int, list<int>> &waitForGraph, list<int> &path) {
-    for (auto &n : waitForGraph) {
-        unordered_set<int> visited;
-        if (dfs(waitForGraph, visited, n.first, path)) {
-            return true;
-        }
+template <typename C>
+string jsonList(const C &values) {
+    string list = "[";
+    for (const auto &value : values) {
+        list += (list.size() > 1 ? ", " : "") + to_string(value);
     }
-    return false;
+    return list + "]";
 }
+
 }  // namespace
 
-TransactionManager::TransactionManager() : time(0){};
-TransactionManager::TransactionManager(const list<Operation> operations)
-    : time(0), operations(operations){};
+TransactionManager::TransactionManager() : time(0), lastFailedTime(0){};
+TransactionManager::TransactionManager(list<Operation> operations,
+                                       const Topology topology,
+                                       const Options options)
+    : time(0),
+      lastFailedTime(0),
+      topology(topology),
+      options(options),
+      replicaSelector(options.readPolicy, options.seed) {
+    for (auto &o : operations) {
+        this->operations.push_back(move(o));
+    }
+};
+TransactionManager::TransactionManager(OperationReader &source,
+                                       const Topology topology,
+                                       const Options options)
+    : time(0),
+      lastFailedTime(0),
+      source(&source),
+      topology(topology),
+      options(options),
+      replicaSelector(options.readPolicy, options.seed){};
+
+template <typename F>
+void TransactionManager::broadcast(const F &fn) {
+    if (options.pipeline) {
+        sitePool.postAll(fn);
+    } else {
+        sitePool.forAll(fn);
+    }
+}
 
 void TransactionManager::simulate() {
     // Site initialization
-    for (int i = 0; i < 10; i++) {
-        sites.emplace_back(Site(i + 1));
+    sitePool.start(topology, options);
+    stats.siteReads.assign(topology.siteCount(), 0);
+    if (!options.traceEvents.empty()) {
+        traceEvents = make_unique<TraceEventWriter>();
+        if (!traceEvents->open(options.traceEvents)) {
+            output().line() << "Error: can not write " << options.traceEvents;
+            traceEvents.reset();
+        }
+        for (int siteId = 1; traceEvents && siteId <= sitePool.size();
+             siteId++) {
+            traceEvents->nameTrack(TraceEventWriter::sites, siteId,
+                                   "site " + to_string(siteId));
+        }
     }
 
-    while (!operations.empty()) {
-        auto curOperation = operations.front();
-        operations.pop_front();
+    Operation curOperation;
+    // once the trace is exhausted, a deadlock no search has reached yet
+    // would leave its transactions waiting forever
+    while (nextOperation(curOperation) ||
+           (options.deadlockPolicy == DeadlockPolicy::DETECT &&
+            maybeDetectDeadlocks(true) && nextOperation(curOperation))) {
         time++;
+        stats.operations++;
+        if (!curOperation.firstRun) {
+            curOperation.firstRun = time;
+        }
+        auto start = chrono::steady_clock::now();
 
         switch (curOperation.action) {
             case Action::BEGIN:
                 begin(curOperation, false);
+                completed(curOperation);
                 break;
             case Action::BEGINRO:
                 begin(curOperation, true);
+                completed(curOperation);
                 break;
             case Action::READ:
                 read(curOperation);
-                detectDeadLock();
+                maybeDetectDeadlocks(false);
                 break;
             case Action::WRITE:
                 write(curOperation);
-                detectDeadLock();
+                maybeDetectDeadlocks(false);
+                break;
+            case Action::SCAN:
+                scan(curOperation);
+                maybeDetectDeadlocks(false);
+                break;
+            case Action::MREAD:
+                readBatch(curOperation);
+                maybeDetectDeadlocks(false);
+                break;
+            case Action::MWRITE:
+                writeBatch(curOperation);
+                maybeDetectDeadlocks(false);
                 break;
             case Action::FAIL:
                 fail(curOperation);
+                completed(curOperation);
                 break;
             case Action::RECOVER:
                 recover(curOperation);
+                completed(curOperation);
                 break;
             case Action::END:
                 commit(curOperation);
                 break;
             case Action::DUMP:
                 dump();
+                completed(curOperation);
                 break;
+            case Action::STATS:
+                printMetrics();
+                completed(curOperation);
+                break;
+        }
+        if (!victims.empty()) {
+            abortVictims();
         }
+        metrics.processed(curOperation.action,
+                          chrono::duration_cast<chrono::nanoseconds>(
+                              chrono::steady_clock::now() - start)
+                              .count());
+    }
+    sitePool.stop();
+    if (traceEvents && !traceEvents->close()) {
+        output().line() << "Error: can not write " << options.traceEvents;
     }
     return;
 }
 
-void TransactionManager::detectDeadLock() {
-    list<int> path;  // store the path where we find a cycle
-    if (!hasCycle(waitForGraph, path)) {
-        return;
+bool TransactionManager::nextOperation(Operation &operation) {
+    if (!operations.empty()) {
+        operation = operations.front();
+        operations.pop_front();
+        return true;
+    }
+    return source && source->next(operation);
+}
+
+bool TransactionManager::periodicDetection() const {
+    return options.deadlockPolicy == DeadlockPolicy::DETECT &&
+           (options.detectEvery > 1 || options.detectAfter > 0);
+}
+
+bool TransactionManager::maybeDetectDeadlocks(const bool force) {
+    if (options.deadlockPolicy != DeadlockPolicy::DETECT) {
+        return false;
+    }
+    if (!force) {
+        if (++sinceDeadlockSearch < options.detectEvery) {
+            return false;
+        }
+        if (options.detectAfter > 0) {
+            int firstBlocked = time;
+            for (const auto &[id, since] : blockedSince) {
+                firstBlocked = min(firstBlocked, since);
+            }
+            if (time - firstBlocked < options.detectAfter) {
+                return false;
+            }
+        }
+    }
+    sinceDeadlockSearch = 0;
+    stats.deadlockSearches++;
+    auto start = chrono::steady_clock::now();
+    bool found = false;
+    if (force || periodicDetection()) {
+        found = detectDeadLocks();
+    } else {
+        found = detectDeadLock();
+    }
+    stats.deadlockSearchNs += chrono::duration_cast<chrono::nanoseconds>(
+                                  chrono::steady_clock::now() - start)
+                                  .count();
+    return found;
+}
+
+bool TransactionManager::detectDeadLock() {
+    vector<int> pool;  // transactions forming the cycle
+    if (!waitForGraph.findCycle(pool)) {
+        return false;
     }
-    cout << "Deadlock happens!" << endl;
-    // extract the path of the cycle
-    auto r = find(path.begin(), path.end(), path.back());
-    vector<int> pool(r, path.end());
-    pool.pop_back();  // remove the repeated one
+    breakDeadLock(pool);
+    return true;
+}
+
+bool TransactionManager::detectDeadLocks() {
+    bool found = false;
+    vector<vector<int>> components;
+    // a component can hold several cycles, one victim may not break all
+    while (waitForGraph.findCycles(components)) {
+        for (const auto &pool : components) {
+            breakDeadLock(pool);
+        }
+        components.clear();
+        found = true;
+    }
+    return found;
+}
+
+void TransactionManager::breakDeadLock(const vector<int> &pool) {
+    stats.deadlocks++;
+    metrics.deadlock(pool.size());
+    output().line() << "Deadlock happens!";
     // find the youngest one
     int youngestTime = 0;
     int transactionToAbort = 0;
     for (const auto &id : pool) {
-        auto tran = idToTransaction[id];
+        const auto &tran = idToTransaction[id];
         if (tran.startTime > youngestTime) {
             youngestTime = tran.startTime;
             transactionToAbort = id;
         }
     }
+    if (traceEvents) {
+        traceEvents->instant(time, TraceEventWriter::transactions,
+                             transactionToAbort, "deadlock",
+                             "{\"cycle\": " + jsonList(pool) + "}");
+    }
+    // a victim a site failure already doomed keeps that reason
+    if (idToTransaction[transactionToAbort].transactionStatus !=
+        TransactionStatus::ABORTED) {
+        metrics.aborted(AbortReason::DEADLOCK);
+    }
     abort(transactionToAbort);
-    return;
+}
+
+void TransactionManager::addWait(const int holder, const int waiter) {
+    if (options.deadlockPolicy == DeadlockPolicy::DETECT) {
+        waitForGraph.addEdge(holder, waiter);
+        return;
+    }
+    auto holderIt = idToTransaction.find(holder);
+    auto waiterIt = idToTransaction.find(waiter);
+    if (holderIt == idToTransaction.end() ||
+        waiterIt == idToTransaction.end()) {
+        return;
+    }
+    bool waiterIsOlder =
+        waiterIt->second.startTime < holderIt->second.startTime;
+    if (options.deadlockPolicy == DeadlockPolicy::WAIT_DIE && !waiterIsOlder) {
+        victims.push_back({waiter, holder});
+    } else if (options.deadlockPolicy == DeadlockPolicy::WOUND_WAIT &&
+               waiterIsOlder) {
+        victims.push_back({holder, waiter});
+    }
+}
+
+bool TransactionManager::isLive(const int transactionId) const {
+    auto it = idToTransaction.find(transactionId);
+    if (it == idToTransaction.end()) {
+        return false;
+    }
+    // a doomed transaction keeps the reads that doomed it
+    auto status = it->second.transactionStatus;
+    return status == TransactionStatus::RUNNING ||
+           status == TransactionStatus::WAITING ||
+           (status == TransactionStatus::ABORTED &&
+            !it->second.readHistory.empty());
+}
+
+bool TransactionManager::isRunning(const int transactionId) const {
+    auto it = idToTransaction.find(transactionId);
+    if (it == idToTransaction.end()) {
+        return false;
+    }
+    auto status = it->second.transactionStatus;
+    return status == TransactionStatus::RUNNING ||
+           status == TransactionStatus::WAITING;
+}
+
+void TransactionManager::abortVictims() {
+    // aborting a victim wakes waiters, which may choose further victims
+    while (!victims.empty()) {
+        auto [victim, other] = victims.front();
+        victims.erase(victims.begin());
+        if (!isLive(victim)) {
+            continue;
+        }
+        if (options.deadlockPolicy == DeadlockPolicy::WAIT_DIE) {
+            output().line() << "T" << victim << " dies waiting for T"
+                            << other;
+        } else {
+            output().line() << "T" << other << " wounds T" << victim;
+        }
+        if (idToTransaction[victim].transactionStatus !=
+            TransactionStatus::ABORTED) {
+            metrics.aborted(AbortReason::DEADLOCK);
+        }
+        abort(victim);
+    }
 }
 
 void TransactionManager::begin(const Operation &curOperation, bool isReadOnly) {
-    Transaction transaction = Transaction(curOperation.transactionId,
-                                          curOperation.timeStamp, isReadOnly);
-    if (isReadOnly) {
-        copyCommitedValue(transaction);
+    idToTransaction.erase(curOperation.transactionId);
+    tombstones.erase(curOperation.transactionId);
+    auto &transaction =
+        idToTransaction
+            .try_emplace(curOperation.transactionId,
+                         curOperation.transactionId, curOperation.timeStamp,
+                         isReadOnly, arenas.acquire())
+            .first->second;
+    if (isReadOnly || snapshotIsolation()) {
+        // read-only transactions read the versions commited before now
+        transaction.snapshotTime = time;
+        activeSnapshots.insert(time);
+    }
+    if (traceEvents) {
+        string name = "T" + to_string(transaction.id);
+        traceEvents->nameTrack(TraceEventWriter::transactions, transaction.id,
+                               name);
+        traceEvents->begin(time, transaction.id, name,
+                           isReadOnly ? "{\"readOnly\": true}" : "");
     }
-    idToTransaction[transaction.id] = transaction;
     if (isReadOnly) {
-        cout << "T" << transaction.id << " begins, and it is read-only" << endl;
+        output().line() << "T" << transaction.id
+                        << " begins, and it is read-only";
     } else {
-        cout << "T" << transaction.id << " begins" << endl;
+        output().line() << "T" << transaction.id << " begins";
     }
 }
 
 void TransactionManager::read(const Operation &curOperation) {
     auto curId = curOperation.transactionId;
-    if (idToTransaction[curId].transactionStatus ==
-        TransactionStatus::ABORTED) {
+    // a retried operation of a transaction that already ended does nothing
+    if (!isRunning(curId)) {
         return;
     }
+    if (deferIfBlocked(curOperation)) {
+        return;
+    }
+    if (options.engine != Engine::LOCKING) {
+        // a transaction buffering its writes reads its own
+        const auto &buffer = idToTransaction[curId].writeBuffer;
+        auto own = buffer.find(curOperation.varIdx);
+        if (own != buffer.end()) {
+            completed(curOperation);
+            output().line() << "T" << curId << " reads x"
+                            << curOperation.varIdx << ": " << own->second;
+            return;
+        }
+    }
 
-    // check if it is a read-only transaction
-    if (idToTransaction[curId].isReadOnly) {
-        if (!idToTransaction[curId].commitedValCopy.count(
-                curOperation.varIdx)) {
-            cout << "T" << curId << " can not read x" << curOperation.varIdx
-                 << " since there are no sites avaialbe. "
-                 << "T" << curId << " aborts!" << endl;
+    // check if it is a read-only transaction, or one reading its snapshot
+    if (idToTransaction[curId].isReadOnly || snapshotIsolation()) {
+        Value snapshotVal = 0;
+        if (!readSnapshot(curOperation.varIdx,
+                          idToTransaction[curId].snapshotTime, snapshotVal)) {
+            output().line() << "T" << curId << " can not read x"
+                            << curOperation.varIdx
+                            << " since there are no sites avaialbe. " << "T"
+                            << curId << " aborts!";
             idToTransaction[curId].transactionStatus =
                 TransactionStatus::ABORTED;
+            releaseSnapshot(idToTransaction[curId]);
+            metrics.aborted(AbortReason::NO_REPLICA);
+            completed(curOperation);
             return;
         }
-        cout << "T" << curId << " reads x" << curOperation.varIdx << ": "
-             << idToTransaction[curId].commitedValCopy[curOperation.varIdx]
-             << endl;
+        output().line() << "T" << curId << " reads x" << curOperation.varIdx
+                        << ": " << snapshotVal;
+        completed(curOperation);
+        if (!idToTransaction[curId].isReadOnly) {
+            noteRead(curId, curOperation.varIdx);
+        }
         return;
     }
 
+    bool optimistic = options.engine == Engine::OPTIMISTIC;
+
+    const auto &siteIds = topology.sitesOf(curOperation.varIdx);
+    vector<size_t> locks;
+    if (replicaSelector.getPolicy() == ReadPolicy::LEAST_LOCKS &&
+        siteIds.size() > 1) {
+        locks.resize(siteIds.size());
+        sitePool.forEach(siteIds, [&](Site &site, size_t i) {
+            locks[i] = site.lockCount();
+        });
+    }
     int lockHolder = -1;  // only write lock can block this operation
     int readVal = 0;
-    bool isRead = false;
-    for (auto &site : sites) {
-        if (!isRead) {
-            isRead = site.read(curId, curOperation.varIdx, lockHolder, readVal);
+    int servedBy = 0;
+    for (const auto &siteId : replicaSelector.order(siteIds, locks)) {
+        if (sitePool.call(siteId, [&](Site &site) {
+                return optimistic ? site.readLatest(curOperation.varIdx,
+                                                    readVal)
+                                  : site.read(curId, curOperation.varIdx,
+                                              lockHolder, readVal);
+            })) {
+            servedBy = siteId;
+            break;
         }
     }
 
-    if (!isRead) {
+    if (!servedBy) {
         // all sites down
         siteFailedOperations.push_back(curOperation);
-        cout << "T" << curId << " can not read x" << curOperation.varIdx
-             << " since there are no sites avaialbe." << endl;
+        output().line() << "T" << curId << " can not read x"
+                        << curOperation.varIdx
+                        << " since there are no sites avaialbe.";
         return;
     }
 
     if (lockHolder != -1 && lockHolder != curId) {
         // this operation is blocked
-        blockedOperations.push_back(curOperation);
-        waitForGraph[lockHolder].push_back(curId);
+        stats.blocked++;
+        block(curOperation, {lockHolder}, curOperation.varIdx);
+        addWait(lockHolder, curId);
         if (idToTransaction[curId].transactionStatus ==
             TransactionStatus::RUNNING) {
             idToTransaction[curId].transactionStatus =
                 TransactionStatus::WAITING;
-            cout << "T" << curId << " can not read x" << curOperation.varIdx
-                 << " since the lock conflicts" << endl;
+            output().line() << "T" << curId << " can not read x"
+                            << curOperation.varIdx
+                            << " since the lock conflicts";
         }
     } else {
         idToTransaction[curId].transactionStatus = TransactionStatus::RUNNING;
-        cout << "T" << curId << " reads x" << curOperation.varIdx << ": "
-             << readVal << endl;
+        granted(curOperation);
+        completed(curOperation);
+        stats.siteReads[servedBy - 1]++;
+        if (traceEvents) {
+            traceEvents->instant(time, TraceEventWriter::transactions, curId,
+                                 "R x" + to_string(curOperation.varIdx),
+                                 "{\"site\": " + to_string(servedBy) + "}");
+        }
+        output().line() << "T" << curId << " reads x" << curOperation.varIdx
+                        << ": " << readVal;
         // update read history
         idToTransaction[curId].readHistory[curOperation.varIdx] = time;
+        if (optimistic) {
+            noteRead(curId, curOperation.varIdx);
+        }
     }
     return;
 }
 
+void TransactionManager::scan(const Operation &curOperation) {
+    ostringstream range;
+    range << "x" << curOperation.varIdx << "-x" << curOperation.val;
+    readMany(curOperation, "scan " + range.str(),
+             "scans " + range.str() + ":");
+}
+
+void TransactionManager::readBatch(const Operation &curOperation) {
+    readMany(curOperation, "read " + variableList(curOperation), "reads");
+}
+
+void TransactionManager::readMany(const Operation &curOperation,
+                                  const string &what, const string &done) {
+    auto curId = curOperation.transactionId;
+    // a retried operation of a transaction that already ended does nothing
+    if (!isRunning(curId)) {
+        return;
+    }
+    if (deferIfBlocked(curOperation)) {
+        return;
+    }
+    auto &transaction = idToTransaction[curId];
+    vector<Index> vars = requestedVariables(curOperation);
+    map<Index, Value> values;
+    vector<int> siteIds;
+
+    if (!transaction.isReadOnly && options.engine == Engine::LOCKING) {
+        vector<vector<Index>> siteVars;
+        if (!assignReads(vars, siteIds, siteVars)) {
+            siteFailedOperations.push_back(curOperation);
+            output().line() << "T" << curId << " can not " << what
+                            << " since there are no sites avaialbe.";
+            return;
+        }
+        vector<int> lockHolders;
+        Index conflict = probeReads(curId, siteIds, siteVars, lockHolders);
+        if (conflict) {
+            // nothing is locked until every site can grant the whole request
+            stats.blocked++;
+            block(curOperation, lockHolders, conflict);
+            for (const auto &lockHolder : lockHolders) {
+                addWait(lockHolder, curId);
+            }
+            if (transaction.transactionStatus == TransactionStatus::RUNNING) {
+                transaction.transactionStatus = TransactionStatus::WAITING;
+                output().line() << "T" << curId << " can not " << what
+                                << " since the lock conflicts";
+            }
+            return;
+        }
+        vector<vector<pair<Index, Value>>> siteValues(siteIds.size());
+        sitePool.forEach(siteIds, [&](Site &site, size_t i) {
+            site.readBatch(curId, siteVars[i], siteValues[i]);
+        });
+        transaction.transactionStatus = TransactionStatus::RUNNING;
+        granted(curOperation);
+        for (size_t i = 0; i < siteIds.size(); i++) {
+            stats.siteReads[siteIds[i] - 1] += siteValues[i].size();
+            for (const auto &[idx, val] : siteValues[i]) {
+                values.emplace(idx, val);
+                transaction.readHistory[idx] = time;
+            }
+        }
+    } else {
+        // reads that take no lock: the snapshot, or the latest committed
+        // values under Engine::OPTIMISTIC
+        bool snapshot = transaction.isReadOnly || snapshotIsolation();
+        if (snapshot) {
+            // the same sites R would read each variable from
+            for (const auto &idx : vars) {
+                Value val;
+                if (readSnapshot(idx, transaction.snapshotTime, val)) {
+                    values.emplace(idx, val);
+                }
+            }
+        } else {
+            vector<vector<pair<Index, Value>>> siteValues(sitePool.size());
+            siteIds = allSites();
+            sitePool.forEach(siteIds, [&](Site &site, size_t i) {
+                site.readLatest(vars, siteValues[i]);
+            });
+            for (size_t i = 0; i < siteIds.size(); i++) {
+                for (const auto &value : siteValues[i]) {
+                    if (values.insert(value).second) {
+                        stats.siteReads[i]++;
+                    }
+                }
+            }
+        }
+        // a transaction buffering its writes reads its own
+        for (const auto &idx : vars) {
+            auto own = transaction.writeBuffer.find(idx);
+            if (own != transaction.writeBuffer.end()) {
+                values[idx] = own->second;
+            }
+        }
+        if (values.size() < vars.size() && snapshot) {
+            output().line() << "T" << curId << " can not " << what
+                            << " since there are no sites avaialbe. " << "T"
+                            << curId << " aborts!";
+            transaction.transactionStatus = TransactionStatus::ABORTED;
+            releaseSnapshot(transaction);
+            metrics.aborted(AbortReason::NO_REPLICA);
+            completed(curOperation);
+            return;
+        }
+        if (values.size() < vars.size()) {
+            siteFailedOperations.push_back(curOperation);
+            output().line() << "T" << curId << " can not " << what
+                            << " since there are no sites avaialbe.";
+            return;
+        }
+        for (const auto &e : values) {
+            if (transaction.isReadOnly ||
+                transaction.writeBuffer.count(e.first)) {
+                continue;
+            }
+            if (!snapshot) {
+                transaction.readHistory[e.first] = time;
+            }
+            noteRead(curId, e.first);
+        }
+        siteIds.clear();
+    }
+
+    completed(curOperation);
+    if (traceEvents) {
+        traceEvents->instant(time, TraceEventWriter::transactions, curId,
+                             traceName(curOperation),
+                             "{\"sites\": " + jsonList(siteIds) + "}");
+    }
+    auto line = output().line();
+    line << "T" << curId << " " << done;
+    const char *delim = " ";
+    for (const auto &[idx, val] : values) {
+        line << delim << "x" << idx << ": " << val;
+        delim = ", ";
+    }
+}
+
+void TransactionManager::writeBatch(const Operation &curOperation) {
+    auto curId = curOperation.transactionId;
+    // a retried operation of a transaction that already ended does nothing
+    if (!isRunning(curId)) {
+        return;
+    }
+    if (deferIfBlocked(curOperation)) {
+        return;
+    }
+    vector<int> siteIds;
+    vector<vector<Index>> siteVars;
+    vector<int> lockHolders;
+    Index conflict =
+        probeWrites(curOperation, siteIds, siteVars, lockHolders);
+    unordered_map<Index, vector<int>> varSites;
+    for (size_t i = 0; i < siteIds.size(); i++) {
+        for (const auto &idx : siteVars[i]) {
+            varSites[idx].push_back(siteIds[i]);
+        }
+    }
+    if (varSites.size() < curOperation.batch.size()) {
+        siteFailedOperations.push_back(curOperation);
+        output().line() << "T" << curId << " can not write "
+                        << variableList(curOperation)
+                        << " since there are no sites avaialbe.";
+        return;
+    }
+    auto &transaction = idToTransaction[curId];
+    if (options.engine != Engine::LOCKING) {
+        completed(curOperation);
+        for (const auto &[idx, val] : curOperation.batch) {
+            transaction.writeBuffer[idx] = val;
+            written(curId, idx, val, varSites[idx]);
+        }
+        return;
+    }
+
+    if (conflict) {
+        // nothing is locked until every site can grant the whole batch
+        stats.blocked++;
+        block(curOperation, lockHolders, conflict);
+        for (const auto &lockHolder : lockHolders) {
+            addWait(lockHolder, curId);
+        }
+        if (transaction.transactionStatus == TransactionStatus::RUNNING) {
+            transaction.transactionStatus = TransactionStatus::WAITING;
+            output().line() << "T" << curId << " can not write "
+                            << variableList(curOperation)
+                            << " since the lock conflicts";
+        }
+        return;
+    }
+    // one request per site, each taking its locks in ascending order
+    vector<vector<pair<Index, Value>>> siteWrites(siteIds.size());
+    for (size_t i = 0; i < siteIds.size(); i++) {
+        auto item = curOperation.batch.begin();
+        for (const auto &idx : siteVars[i]) {
+            while (item->first != idx) {
+                item++;
+            }
+            siteWrites[i].push_back(*item);
+        }
+    }
+    sitePool.forEach(siteIds, [&](Site &site, size_t i) {
+        site.writeBatch(curId, siteWrites[i]);
+    });
+    transaction.transactionStatus = TransactionStatus::RUNNING;
+    granted(curOperation);
+    completed(curOperation);
+    for (const auto &[idx, val] : curOperation.batch) {
+        written(curId, idx, val, varSites[idx]);
+        // keep tracking uncommited variable
+        uncommitedVariable[idx] = time;
+    }
+}
+
+vector<Index> TransactionManager::requestedVariables(
+    const Operation &curOperation) const {
+    vector<Index> vars;
+    if (curOperation.action == Action::SCAN) {
+        for (Index idx = max(curOperation.varIdx, 1);
+             idx <= min(curOperation.val, topology.variableCount()); idx++) {
+            if (topology.hasVariable(idx)) {
+                vars.push_back(idx);
+            }
+        }
+    } else {
+        for (const auto &item : curOperation.batch) {
+            vars.push_back(item.first);
+        }
+    }
+    return vars;
+}
+
+string TransactionManager::variableList(const Operation &curOperation) {
+    string list;
+    for (const auto &item : curOperation.batch) {
+        list += (list.empty() ? "x" : ", x") + to_string(item.first);
+    }
+    return list;
+}
+
+vector<int> TransactionManager::allSites() const {
+    vector<int> siteIds(sitePool.size());
+    for (int siteId = 1; siteId <= sitePool.size(); siteId++) {
+        siteIds[siteId - 1] = siteId;
+    }
+    return siteIds;
+}
+
+void TransactionManager::noteRead(const int transactionId, const Index idx) {
+    auto &transaction = idToTransaction[transactionId];
+    if (options.engine == Engine::OPTIMISTIC) {
+        auto version = lastCommitTime.find(idx);
+        transaction.readVersions.emplace(
+            idx, version == lastCommitTime.end() ? 0 : version->second);
+    } else if (transaction.readVersions.emplace(idx, transaction.snapshotTime)
+                   .second &&
+               options.engine == Engine::SERIALIZABLE_SNAPSHOT) {
+        snapshotReaders[idx].push_back(transactionId);
+    }
+}
+
+bool TransactionManager::assignReads(const vector<Index> &vars,
+                                     vector<int> &siteIds,
+                                     vector<vector<Index>> &siteVars) {
+    vector<int> candidates = allSites();
+    vector<vector<Index>> readable(candidates.size());
+    sitePool.forEach(candidates, [&](Site &site, size_t i) {
+        site.readableIn(vars, readable[i]);
+    });
+    // `vars` is ascending, so a variable's position is found by bisection
+    vector<char> covered(vars.size());
+    size_t coveredCount = 0;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        vector<Index> served;
+        for (const auto &idx : readable[i]) {
+            size_t pos =
+                lower_bound(vars.begin(), vars.end(), idx) - vars.begin();
+            if (!covered[pos]) {
+                covered[pos] = 1;
+                coveredCount++;
+                served.push_back(idx);
+            }
+        }
+        if (!served.empty()) {
+            siteIds.push_back(candidates[i]);
+            siteVars.push_back(move(served));
+        }
+    }
+    return coveredCount == vars.size();
+}
+
+Index TransactionManager::probeReads(const int transactionId,
+                                     const vector<int> &siteIds,
+                                     const vector<vector<Index>> &siteVars,
+                                     vector<int> &lockHolders) {
+    vector<vector<int>> holders(siteIds.size());
+    vector<Index> conflicts(siteIds.size());
+    sitePool.forEach(siteIds, [&](Site &site, size_t i) {
+        conflicts[i] = site.probeReads(transactionId, siteVars[i], holders[i]);
+    });
+    return mergeConflicts(conflicts, holders, lockHolders);
+}
+
+Index TransactionManager::probeWrites(const Operation &curOperation,
+                                      vector<int> &siteIds,
+                                      vector<vector<Index>> &siteVars,
+                                      vector<int> &lockHolders) {
+    vector<int> candidates = allSites();
+    vector<vector<Index>> writable(candidates.size());
+    vector<vector<int>> holders(candidates.size());
+    vector<Index> conflicts(candidates.size());
+    sitePool.forEach(candidates, [&](Site &site, size_t i) {
+        conflicts[i] = site.probeWrites(curOperation.transactionId,
+                                        curOperation.batch, writable[i],
+                                        holders[i]);
+    });
+    for (size_t i = 0; i < candidates.size(); i++) {
+        if (!writable[i].empty()) {
+            siteIds.push_back(candidates[i]);
+            siteVars.push_back(move(writable[i]));
+        }
+    }
+    return mergeConflicts(conflicts, holders, lockHolders);
+}
+
+Index TransactionManager::mergeConflicts(const vector<Index> &conflicts,
+                                         const vector<vector<int>> &holders,
+                                         vector<int> &lockHolders) {
+    Index conflict = 0;
+    for (size_t i = 0; i < conflicts.size(); i++) {
+        for (const auto &holder : holders[i]) {
+            if (find(lockHolders.begin(), lockHolders.end(), holder) ==
+                lockHolders.end()) {
+                lockHolders.push_back(holder);
+            }
+        }
+        if (conflicts[i] && (!conflict || conflicts[i] < conflict)) {
+            conflict = conflicts[i];
+        }
+    }
+    return conflict;
+}
+
 void TransactionManager::write(const Operation &curOperation) {
     auto curId = curOperation.transactionId;
-    if (idToTransaction[curId].transactionStatus ==
-        TransactionStatus::ABORTED) {
+    // a retried operation of a transaction that already ended does nothing
+    if (!isRunning(curId)) {
+        return;
+    }
+    if (deferIfBlocked(curOperation)) {
+        return;
+    }
+    if (options.engine != Engine::LOCKING) {
+        bufferWrite(curOperation);
         return;
     }
 
     // check site's availability
+    const auto &siteIds = topology.sitesOf(curOperation.varIdx);
+    vector<char> isWritten(siteIds.size());
+    vector<vector<int>> siteLockHolders(siteIds.size());
+    sitePool.forEach(siteIds, [&](Site &site, size_t i) {
+        isWritten[i] = site.write(curId, curOperation.varIdx, curOperation.val,
+                                  siteLockHolders[i]);
+    });
     unordered_set<int> lockHolders;
     vector<int> affectedSiteIndexes;
-    for (size_t i = 0; i < 10; i++) {
-        if (sites[i].write(curId, curOperation.varIdx, curOperation.val,
-                           lockHolders)) {
-            affectedSiteIndexes.push_back(i + 1);
+    for (size_t i = 0; i < siteIds.size(); i++) {
+        lockHolders.insert(siteLockHolders[i].begin(),
+                           siteLockHolders[i].end());
+        if (isWritten[i]) {
+            affectedSiteIndexes.push_back(siteIds[i]);
         }
     }
 
     // if all sites down
     if (affectedSiteIndexes.empty() && lockHolders.empty()) {
         siteFailedOperations.push_back(curOperation);
-        cout << "T" << curId << " can not write x" << curOperation.varIdx
-             << " since there are no sites avaialbe." << endl;
+        output().line() << "T" << curId << " can not write x"
+                        << curOperation.varIdx
+                        << " since there are no sites avaialbe.";
         return;
     }
 
     // if operation is blocked
     if (!lockHolders.empty()) {
-        blockedOperations.push_back(curOperation);
+        stats.blocked++;
+        lockHolders.erase(curId);
+        block(curOperation,
+              vector<int>(lockHolders.begin(), lockHolders.end()),
+              curOperation.varIdx);
+        // the sites that granted the write keep its lock
+        if (!affectedSiteIndexes.empty()) {
+            addQueueEdges(curOperation);
+        }
         for (const auto &lockHolder : lockHolders) {
             if (lockHolder == curId) {
                 continue;
             }
 
-            waitForGraph[lockHolder].push_back(curId);
+            addWait(lockHolder, curId);
         }
         if (idToTransaction[curId].transactionStatus ==
             TransactionStatus::RUNNING) {
             idToTransaction[curId].transactionStatus =
                 TransactionStatus::WAITING;
-            cout << "T" << curId << " can not write x" << curOperation.varIdx
-                 << " since the lock conflicts" << endl;
+            output().line() << "T" << curId << " can not write x"
+                            << curOperation.varIdx
+                            << " since the lock conflicts";
         }
         return;
     }
 
     // else
     idToTransaction[curId].transactionStatus = TransactionStatus::RUNNING;
-    idToTransaction[curId].affectedVariables.insert(curOperation.varIdx);
-    cout << "T" << curId << " writes x" << curOperation.varIdx << " as "
-         << curOperation.val << ", and affected sites are ";
-    for (const auto &siteIndex : affectedSiteIndexes) {
-        cout << siteIndex << " ";
-    }
-    cout << endl;
+    granted(curOperation);
+    completed(curOperation);
+    written(curId, curOperation.varIdx, curOperation.val,
+            affectedSiteIndexes);
     // keep tracking uncommited variable
     uncommitedVariable[curOperation.varIdx] = time;
-    // update write history
-    idToTransaction[curId].writeHistory[curOperation.varIdx] = time;
     return;
 }
 
-void TransactionManager::commit(const Operation &curOperation) {
+void TransactionManager::bufferWrite(const Operation &curOperation) {
     auto curId = curOperation.transactionId;
-    if (idToTransaction[curId].transactionStatus ==
-        TransactionStatus::ABORTED) {
-        abort(curId);
+    const auto &siteIds = topology.sitesOf(curOperation.varIdx);
+    vector<char> isAvailable(siteIds.size());
+    sitePool.forEach(siteIds, [&](Site &site, size_t i) {
+        isAvailable[i] = site.probeWrite(curId, curOperation.varIdx) !=
+                         Access::UNAVAILABLE;
+    });
+    vector<int> availableSites;
+    for (size_t i = 0; i < siteIds.size(); i++) {
+        if (isAvailable[i]) {
+            availableSites.push_back(siteIds[i]);
+        }
+    }
+    if (availableSites.empty()) {
+        siteFailedOperations.push_back(curOperation);
+        output().line() << "T" << curId << " can not write x"
+                        << curOperation.varIdx
+                        << " since there are no sites avaialbe.";
         return;
     }
-    // check if affected variables can commit
-    bool ableToCommit = true;
-    // check if sites are up
-    for (const auto &av : idToTransaction[curId].affectedVariables) {
-        if (av % 2 == 0) {
-            for (const auto &site : sites) {
-                // if write time before fail
-                if (site.siteStatus == SiteStatus::DOWN &&
-                    site.curVal.count(av)) {
-                    ableToCommit = false;
-                    break;
-                }
+    idToTransaction[curId].writeBuffer[curOperation.varIdx] =
+        curOperation.val;
+    completed(curOperation);
+    written(curId, curOperation.varIdx, curOperation.val, availableSites);
+}
+
+void TransactionManager::written(const int curId, const Index idx,
+                                 const Value val, const vector<int> &siteIds) {
+    if (traceEvents) {
+        traceEvents->instant(time, TraceEventWriter::transactions, curId,
+                             "W x" + to_string(idx),
+                             "{\"sites\": " + jsonList(siteIds) + "}");
+    }
+    idToTransaction[curId].affectedVariables.insert(idx);
+    {
+        auto line = output().line();
+        line << "T" << curId << " writes x" << idx << " as " << val
+             << ", and affected sites are ";
+        for (const auto &siteIndex : siteIds) {
+            line << siteIndex << " ";
+        }
+    }
+    // update write history
+    idToTransaction[curId].writeHistory[idx] = time;
+}
+
+bool TransactionManager::snapshotIsolation() const {
+    return options.engine == Engine::SNAPSHOT ||
+           options.engine == Engine::SERIALIZABLE_SNAPSHOT;
+}
+
+bool TransactionManager::validate(Transaction &transaction) {
+    if (options.engine == Engine::OPTIMISTIC) {
+        // backward validation: every variable read still has the version the
+        // read saw
+        for (const auto &[idx, version] : transaction.readVersions) {
+            auto latest = lastCommitTime.find(idx);
+            if (latest != lastCommitTime.end() && latest->second != version) {
+                output().line() << "T" << transaction.id
+                                << " fails validation since x" << idx
+                                << " was written after it was read";
+                return false;
             }
-        } else if (sites[av % 10].siteStatus == SiteStatus::DOWN ||
-                   (sites[av % 10].siteStatus == SiteStatus::UP &&
-                    !sites[av % 10].curVal.count(av))) {
-            // non-replicated variable
-            ableToCommit = false;
         }
+        return true;
     }
-    // check if there's write operations before a site failed
-    for (const auto &site : sites) {
-        for (const auto &idx : idToTransaction[curId].affectedVariables) {
-            if (site.restrictedWriteVariable.count(idx)) {
-                ableToCommit = false;
+    // first committer wins
+    for (const auto &e : transaction.writeBuffer) {
+        auto latest = lastCommitTime.find(e.first);
+        if (latest != lastCommitTime.end() &&
+            latest->second > transaction.snapshotTime) {
+            output().line() << "T" << transaction.id
+                            << " fails validation since x" << e.first
+                            << " was committed after its snapshot";
+            return false;
+        }
+    }
+    return options.engine != Engine::SERIALIZABLE_SNAPSHOT ||
+           checkAntiDependencies(transaction);
+}
+
+bool TransactionManager::checkAntiDependencies(Transaction &transaction) {
+    // concurrent commits that overwrote a version this transaction read
+    vector<Tombstone *> overwriters;
+    for (const auto &e : transaction.readVersions) {
+        auto writers = snapshotWriters.find(e.first);
+        if (writers == snapshotWriters.end()) {
+            continue;
+        }
+        for (const auto &[commitTime, writer] : writers->second) {
+            auto overwriter = tombstones.find(writer);
+            if (commitTime > transaction.snapshotTime &&
+                overwriter != tombstones.end()) {
+                overwriters.push_back(&overwriter->second);
             }
-            if (idToTransaction[curId].writeHistory[idx] < site.failedTime) {
-                ableToCommit = false;
+        }
+    }
+    // concurrent transactions that read a version this one overwrites
+    vector<Transaction *> runningReaders;
+    vector<Tombstone *> committedReaders;
+    for (const auto &e : transaction.writeBuffer) {
+        auto it = snapshotReaders.find(e.first);
+        if (it == snapshotReaders.end()) {
+            continue;
+        }
+        for (const auto &reader : it->second) {
+            if (reader == transaction.id) {
+                continue;
+            }
+            if (isRunning(reader)) {
+                runningReaders.push_back(&idToTransaction.at(reader));
+                continue;
+            }
+            auto ended = tombstones.find(reader);
+            if (ended != tombstones.end() &&
+                ended->second.transactionStatus ==
+                    TransactionStatus::COMMITED &&
+                ended->second.commitTime > transaction.snapshotTime) {
+                committedReaders.push_back(&ended->second);
             }
         }
-        for (const auto &e : idToTransaction[curId].readHistory) {
-            if (site.commitedVal.count(e.first) && time < site.failedTime) {
-                ableToCommit = false;
+    }
+    bool in = transaction.inConflict || !runningReaders.empty() ||
+              !committedReaders.empty();
+    bool out = transaction.outConflict || !overwriters.empty();
+    // a committed neighbour that would become a pivot can not abort anymore
+    bool committedPivot =
+        any_of(overwriters.begin(), overwriters.end(),
+               [](const Tombstone *t) { return t->outConflict; }) ||
+        any_of(committedReaders.begin(), committedReaders.end(),
+               [](const Tombstone *t) { return t->inConflict; });
+    if ((in && out) || committedPivot) {
+        output().line() << "T" << transaction.id
+                        << " fails validation since it would complete two "
+                           "consecutive rw-antidependencies";
+        return false;
+    }
+    transaction.inConflict = in;
+    transaction.outConflict = out;
+    for (auto *writer : overwriters) {
+        writer->inConflict = true;
+    }
+    for (auto *reader : runningReaders) {
+        reader->outConflict = true;
+    }
+    for (auto *reader : committedReaders) {
+        reader->outConflict = true;
+    }
+    return true;
+}
+
+void TransactionManager::pruneConflictHistory(const Transaction &transaction) {
+    int horizon = versionHorizon();
+    for (const auto &e : transaction.writeBuffer) {
+        auto &writers = snapshotWriters[e.first];
+        writers.emplace_back(transaction.commitTime, transaction.id);
+        while (writers.front().first <= horizon) {
+            writers.pop_front();
+            if (writers.empty()) {
+                snapshotWriters.erase(e.first);
+                break;
             }
         }
     }
-    // check if `siteFailedOperations` contains the operations of this
-    // transaction
-    auto it = siteFailedOperations.begin();
-    while (it != siteFailedOperations.end()) {
-        if ((*it).transactionId == curId) {
+    // `transaction` itself has not been replaced by its tombstone yet
+    auto isOld = [&](const int reader) {
+        auto live = idToTransaction.find(reader);
+        if (live != idToTransaction.end()) {
+            auto status = live->second.transactionStatus;
+            return status == TransactionStatus::ABORTED ||
+                   (status == TransactionStatus::COMMITED &&
+                    live->second.commitTime <= horizon);
+        }
+        auto ended = tombstones.find(reader);
+        return ended == tombstones.end() ||
+               ended->second.transactionStatus == TransactionStatus::ABORTED ||
+               ended->second.commitTime <= horizon;
+    };
+    auto pruneReaders = [&](const int idx) {
+        auto it = snapshotReaders.find(idx);
+        if (it == snapshotReaders.end()) {
+            return;
+        }
+        auto &readers = it->second;
+        readers.erase(remove_if(readers.begin(), readers.end(), isOld),
+                      readers.end());
+        if (readers.empty()) {
+            snapshotReaders.erase(it);
+        }
+    };
+    for (const auto &e : transaction.readVersions) {
+        pruneReaders(e.first);
+    }
+    for (const auto &e : transaction.writeBuffer) {
+        pruneReaders(e.first);
+    }
+}
+
+void TransactionManager::commit(const Operation &curOperation) {
+    auto curId = curOperation.transactionId;
+    auto live = idToTransaction.find(curId);
+    if (live == idToTransaction.end() ||
+        live->second.transactionStatus == TransactionStatus::ABORTED) {
+        // a transaction doomed or aborted while it ran; nothing is left of
+        // one that never began or already ended
+        auto tombstone = tombstones.find(curId);
+        if (live != idToTransaction.end() ||
+            (tombstone != tombstones.end() &&
+             tombstone->second.transactionStatus ==
+                 TransactionStatus::ABORTED)) {
+            stats.aborts++;
+            abort(curId);
+            completed(curOperation);
+            // end() is the last operation of the transaction
+            tombstones.erase(curId);
+        }
+        return;
+    }
+    if (deferIfBlocked(curOperation)) {
+        return;
+    }
+    // check if affected variables can commit
+    bool ableToCommit = true;
+    const auto &transaction = idToTransaction[curId];
+    // check if there's write operations before a site failed
+    for (const auto &idx : transaction.affectedVariables) {
+        if (transaction.writeHistory.at(idx) < lastFailedTime) {
+            ableToCommit = false;
+        }
+    }
+    // check if sites are up
+    vector<int> involvedSites;
+    for (const auto &idx : transaction.affectedVariables) {
+        const auto &siteIds = topology.sitesOf(idx);
+        involvedSites.insert(involvedSites.end(), siteIds.begin(),
+                             siteIds.end());
+    }
+    for (const auto &e : transaction.readHistory) {
+        const auto &siteIds = topology.sitesOf(e.first);
+        involvedSites.insert(involvedSites.end(), siteIds.begin(),
+                             siteIds.end());
+    }
+    sort(involvedSites.begin(), involvedSites.end());
+    involvedSites.erase(unique(involvedSites.begin(), involvedSites.end()),
+                        involvedSites.end());
+    // buffered writes have nothing on the sites to lose yet
+    bool buffered = options.engine != Engine::LOCKING;
+    vector<char> siteCanCommit(involvedSites.size());
+    sitePool.forEach(involvedSites, [&](Site &site, size_t i) {
+        siteCanCommit[i] = site.canCommit(
+            buffered ? noWrites : transaction.affectedVariables,
+            transaction.readHistory, time);
+    });
+    for (const auto &ok : siteCanCommit) {
+        if (!ok) {
             ableToCommit = false;
-            it = siteFailedOperations.erase(it);
-        } else {
-            it++;
         }
     }
+    // check if `siteFailedOperations` contains the operations of this
+    // transaction
+    auto failed = remove_if(
+        siteFailedOperations.begin(), siteFailedOperations.end(),
+        [&](const Operation &o) { return o.transactionId == curId; });
+    if (failed != siteFailedOperations.end()) {
+        ableToCommit = false;
+        siteFailedOperations.erase(failed, siteFailedOperations.end());
+    }
     // abort
     if (!ableToCommit) {
+        stats.aborts++;
+        metrics.aborted(AbortReason::SITE_FAILURE);
         abort(curId);
+        completed(curOperation);
+        tombstones.erase(curId);
         return;
     }
-    // change curValue to commitedValue
-    for (auto &site : sites) {
-        if (site.siteStatus != SiteStatus::DOWN) {
-            site.commit(curId, idToTransaction[curId].affectedVariables);
+    if (buffered) {
+        if (!validate(idToTransaction[curId])) {
+            stats.aborts++;
+            stats.validationFailures++;
+            metrics.aborted(AbortReason::VALIDATION);
+            abort(curId);
+            completed(curOperation);
+            tombstones.erase(curId);
+            return;
+        }
+        for (const auto &e : transaction.writeBuffer) {
+            lastCommitTime[e.first] = time;
         }
     }
+    // change curValue to commitedValue
+    releaseSnapshot(idToTransaction[curId]);
+    auto lockedVars = lockedVariables(curId);
+    if (buffered) {
+        const auto &writeBuffer = idToTransaction[curId].writeBuffer;
+        broadcast([time = time, horizon = versionHorizon(),
+                   buffer = make_shared<const map<Index, Value>>(
+                       writeBuffer.begin(), writeBuffer.end())](Site &site) {
+            if (site.siteStatus != SiteStatus::DOWN) {
+                site.install(*buffer, time, horizon);
+            }
+        });
+    } else {
+        const auto &affectedVariables =
+            idToTransaction[curId].affectedVariables;
+        broadcast([curId, time = time, horizon = versionHorizon(),
+                   affected = make_shared<const unordered_set<int>>(
+                       affectedVariables.begin(), affectedVariables.end())](
+                      Site &site) {
+            if (site.siteStatus != SiteStatus::DOWN) {
+                site.commit(curId, *affected, time, horizon);
+            }
+        });
+    }
     idToTransaction[curId].transactionStatus = TransactionStatus::COMMITED;
-    cout << "T" << curId << " commits!" << endl;
+    idToTransaction[curId].commitTime = time;
+    if (options.engine == Engine::SERIALIZABLE_SNAPSHOT) {
+        pruneConflictHistory(idToTransaction[curId]);
+    }
+    stats.commits++;
+    completed(curOperation);
+    if (traceEvents) {
+        traceEvents->end(time, curId,
+                         "{\"outcome\": \"commit\", \"sites\": " +
+                             jsonList(involvedSites) + "}");
+    }
+    output().line() << "T" << curId << " commits!";
 
     // update uncommitedVarialbe
     for (const auto &idx : idToTransaction[curId].affectedVariables) {
@@ -320,58 +1264,70 @@ void TransactionManager::commit(const Operation &curOperation) {
     }
 
     // deal with operations which are blocked by this transaction
-    // iterate each waiting transaction backward and push_front its related
-    // blocked operations to the operations queue
-    auto blockedTrans = waitForGraph[curId];
-    for (auto i = blockedTrans.rbegin(); i != blockedTrans.rend(); i++) {
-        for (auto j = blockedOperations.rbegin(); j != blockedOperations.rend();
-             j++) {
-            if ((*j).transactionId == (*i)) {
-                operations.push_front(*j);
-            }
-        }
-    }
-    unordered_set<int> blockedTransSet(blockedTrans.begin(),
-                                       blockedTrans.end());
-    auto removeUnblockedTrans =
-        remove_if(blockedOperations.begin(), blockedOperations.end(),
-                  [&](const Operation &o) {
-                      return blockedTransSet.count(o.transactionId);
-                  });
-    blockedOperations.erase(removeUnblockedTrans, blockedOperations.end());
-
-    waitForGraph.erase(curId);
+    waitForGraph.removeWaitersOf(curId);
+    wakeWaiters(lockedVars);
+    retire(curId);
 }
 
 void TransactionManager::fail(const Operation &curOperation) {
-    if (sites[curOperation.siteId - 1].fail(time)) {
-        cout << "Site" << curOperation.siteId << " fails!" << endl;
+    if (!isValidSite(curOperation.siteId)) {
+        return;
+    }
+    if (sitePool.call(curOperation.siteId,
+                      [&](Site &site) { return site.fail(time); })) {
+        lastFailedTime = time;
+        if (traceEvents) {
+            traceEvents->instant(time, TraceEventWriter::sites,
+                                 curOperation.siteId, "fail");
+        }
+        output().line() << "Site" << curOperation.siteId << " fails!";
     }
 }
 
 void TransactionManager::recover(const Operation &curOperation) {
     auto curSid = curOperation.siteId;
-    if (sites[curSid - 1].recover()) {
-        cout << "Site" << curSid << " recovers!" << endl;
+    if (!isValidSite(curSid)) {
+        return;
+    }
+    int failedTime = 0;
+    bool isRecovered = sitePool.call(curSid, [&](Site &site) {
+        if (!site.recover(time)) {
+            return false;
+        }
+        site.collectVersions(versionHorizon());
+        failedTime = site.failedTime;
 
         // let this site knows there exists uncommited variables before it
         // failed
         for (const auto &e : uncommitedVariable) {
             // check if this happened before the site failed
-            if (e.second > sites[curSid - 1].failedTime) {
+            if (e.second > site.failedTime) {
                 continue;
             }
-            if (sites[curSid - 1].commitedVal.count(e.first)) {
-                sites[curSid - 1].restrictedWriteVariable.insert(e.first);
+            if (site.hasVariable(e.first)) {
+                site.restrictedWriteVariable.insert(e.first);
             }
         }
+        return true;
+    });
+    if (isRecovered) {
+        if (traceEvents) {
+            traceEvents->instant(time, TraceEventWriter::sites, curSid,
+                                 "recover");
+        }
+        output().line() << "Site" << curSid << " recovers!";
 
         // check invalid read for replicated variables
         for (auto &e : idToTransaction) {
             for (const auto &v : e.second.readHistory) {
-                if (sites[curSid - 1].commitedVal.count(v.first) &&
-                    v.second < sites[curSid - 1].failedTime) {
-                    e.second.transactionStatus = TransactionStatus::ABORTED;
+                if (topology.isStoredOn(v.first, curSid) &&
+                    v.second < failedTime) {
+                    auto &status = e.second.transactionStatus;
+                    if (status == TransactionStatus::RUNNING ||
+                        status == TransactionStatus::WAITING) {
+                        metrics.aborted(AbortReason::SITE_FAILURE);
+                    }
+                    status = TransactionStatus::ABORTED;
                 }
             }
         }
@@ -386,76 +1342,353 @@ void TransactionManager::recover(const Operation &curOperation) {
 }
 
 void TransactionManager::abort(const int transactionToAbort) {
-    for (auto &site : sites) {
-        site.abort(transactionToAbort);
+    // end() aborts a transaction aborted earlier again, to report it
+    vector<int> lockedVars;
+    auto live = idToTransaction.find(transactionToAbort);
+    if (live != idToTransaction.end()) {
+        auto &transaction = live->second;
+        releaseSnapshot(transaction);
+        lockedVars = lockedVariables(transactionToAbort);
+        const auto &affectedVariables = transaction.affectedVariables;
+        broadcast([transactionToAbort,
+                   affected = make_shared<const unordered_set<int>>(
+                       affectedVariables.begin(), affectedVariables.end())](
+                      Site &site) {
+            site.abort(transactionToAbort);
 
-        for (const auto &var :
-             idToTransaction[transactionToAbort].affectedVariables) {
-            if (site.restrictedWriteVariable.count(var)) {
-                site.restrictedWriteVariable.erase(var);
+            for (const auto &var : *affected) {
+                if (site.restrictedWriteVariable.count(var)) {
+                    site.restrictedWriteVariable.erase(var);
+                }
+            }
+        });
+        Arena *arena = transaction.arena;
+        idToTransaction.erase(live);
+        arenas.release(arena);
+    }
+    waitForGraph.removeTransaction(transactionToAbort);
+    if (blockedSince.erase(transactionToAbort) && traceEvents) {
+        traceEvents->end(time, transactionToAbort);
+    }
+    if (traceEvents) {
+        traceEvents->end(time, transactionToAbort,
+                         "{\"outcome\": \"abort\"}");
+    }
+
+    // drop the requests of the aborted transaction; its end() still runs so
+    // the abort is reported
+    auto waiting = waitingOn.find(transactionToAbort);
+    if (waiting != waitingOn.end()) {
+        auto queue = waitQueues.find(waiting->second);
+        queue->second.erase(remove_if(queue->second.begin(),
+                                      queue->second.end(),
+                                      [&](const Operation &o) {
+                                          return o.transactionId ==
+                                                 transactionToAbort;
+                                      }),
+                            queue->second.end());
+        waitingOn.erase(waiting);
+    }
+    auto deferred = deferredOperations.find(transactionToAbort);
+    if (deferred != deferredOperations.end()) {
+        for (const auto &o : deferred->second) {
+            if (o.action == Action::END) {
+                operations.push_front(o);
             }
         }
+        deferredOperations.erase(deferred);
     }
-    idToTransaction.erase(transactionToAbort);
-    unordered_set<int> waitedTrans(waitForGraph[transactionToAbort].begin(),
-                                   waitForGraph[transactionToAbort].end());
-    waitForGraph.erase(transactionToAbort);
-    for (auto &e : waitForGraph) {
-        e.second.remove(transactionToAbort);
+    wakeWaiters(lockedVars);
+
+    tombstones[transactionToAbort] = {TransactionStatus::ABORTED};
+    output().line() << "T" << transactionToAbort << " aborts!";
+
+    return;
+}
+
+bool TransactionManager::deferIfBlocked(const Operation &curOperation) {
+    if (!waitingOn.count(curOperation.transactionId)) {
+        return false;
     }
+    deferredOperations[curOperation.transactionId].push_back(curOperation);
+    return true;
+}
 
-    // add unblocked operations back to operations queue
-    for (auto i = blockedOperations.rbegin(); i != blockedOperations.rend();
-         i++) {
-        if (waitedTrans.count((*i).transactionId)) {
-            operations.push_front(*i);
+void TransactionManager::block(const Operation &curOperation,
+                               const vector<int> &blockers, const int varIdx) {
+    auto &queue = waitQueues[varIdx];
+    queue.push_back(curOperation);
+    metrics.queued(queue.size());
+    waitingOn[curOperation.transactionId] = varIdx;
+    // a woken request that has to wait again keeps its first time
+    bool firstWait =
+        blockedSince.emplace(curOperation.transactionId, time).second;
+    if (traceEvents && firstWait) {
+        traceEvents->begin(time, curOperation.transactionId,
+                           "wait " + traceName(curOperation),
+                           "{\"blockers\": " + jsonList(blockers) + "}");
+    }
+}
+
+void TransactionManager::granted(const Operation &curOperation) {
+    waitForGraph.removeWaitsOf(curOperation.transactionId);
+    addQueueEdges(curOperation);
+    auto since = blockedSince.find(curOperation.transactionId);
+    if (since != blockedSince.end()) {
+        metrics.waited(curOperation.varIdx, time - since->second);
+        blockedSince.erase(since);
+        if (traceEvents) {
+            traceEvents->end(time, curOperation.transactionId);
         }
     }
-    auto removeUnblockedTrans =
-        remove_if(blockedOperations.begin(), blockedOperations.end(),
-                  [&](const Operation &o) {
-                      return o.transactionId == transactionToAbort ||
-                             waitedTrans.count(o.transactionId);
-                  });
-    blockedOperations.erase(removeUnblockedTrans, blockedOperations.end());
+}
 
-    idToTransaction[transactionToAbort].transactionStatus =
-        TransactionStatus::ABORTED;
-    cout << "T" << transactionToAbort << " aborts!" << endl;
+void TransactionManager::completed(const Operation &curOperation) {
+    metrics.completed(curOperation.action, time - curOperation.firstRun);
+}
 
-    // update waitForGraph
-    for (auto i = waitForGraph.cbegin(); i != waitForGraph.cend();) {
-        if (i->second.size() == 0) {
-            waitForGraph.erase(i++);
-        } else {
-            i++;
+void TransactionManager::addQueueEdges(const Operation &curOperation) {
+    bool isWrite = writes(curOperation);
+    auto addEdges = [&](const RingQueue<Operation> &waiters) {
+        for (const auto &o : waiters) {
+            if (o.transactionId != curOperation.transactionId &&
+                (isWrite || writes(o))) {
+                addWait(curOperation.transactionId, o.transactionId);
+            }
+        }
+    };
+    auto addEdgesOf = [&](const int varIdx) {
+        auto queue = waitQueues.find(varIdx);
+        if (queue != waitQueues.end()) {
+            addEdges(queue->second);
+        }
+    };
+    if (!isBatch(curOperation)) {
+        addEdgesOf(curOperation.varIdx);
+    } else if (curOperation.action != Action::SCAN) {
+        for (const auto &item : curOperation.batch) {
+            addEdgesOf(item.first);
+        }
+    } else if (static_cast<size_t>(curOperation.val - curOperation.varIdx) <
+               waitQueues.size()) {
+        for (int idx = curOperation.varIdx; idx <= curOperation.val; idx++) {
+            addEdgesOf(idx);
+        }
+    } else {
+        // a wide scan visits the queues instead of its variables
+        for (const auto &[var, waiters] : waitQueues) {
+            if (holds(curOperation, var)) {
+                addEdges(waiters);
+            }
         }
     }
+}
 
-    return;
+vector<int> TransactionManager::lockedVariables(const int transactionId) {
+    const auto &transaction = idToTransaction[transactionId];
+    vector<int> vars(transaction.affectedVariables.begin(),
+                     transaction.affectedVariables.end());
+    for (const auto &e : transaction.readHistory) {
+        vars.push_back(e.first);
+    }
+    // a blocked write may hold locks on the sites that granted it
+    auto waiting = waitingOn.find(transactionId);
+    if (waiting != waitingOn.end()) {
+        vars.push_back(waiting->second);
+    }
+    // requests queued behind one the transaction was woken for wait for it
+    auto woken = wokenOn.find(transactionId);
+    if (woken != wokenOn.end()) {
+        vars.insert(vars.end(), woken->second.begin(), woken->second.end());
+        wokenOn.erase(woken);
+    }
+    sort(vars.begin(), vars.end());
+    vars.erase(unique(vars.begin(), vars.end()), vars.end());
+    return vars;
 }
 
-void TransactionManager::dumpDebug() {
-    cout << endl;
-    cout << "Blocked Transactions: ";
-    for (const auto &o : blockedOperations) {
-        cout << o << " ";
+Index TransactionManager::batchConflict(const Operation &curOperation,
+                                        vector<int> &lockHolders) {
+    vector<int> siteIds;
+    vector<vector<Index>> siteVars;
+    if (curOperation.action == Action::MWRITE) {
+        return probeWrites(curOperation, siteIds, siteVars, lockHolders);
+    }
+    if (!assignReads(requestedVariables(curOperation), siteIds, siteVars)) {
+        // the retried request finds no site
+        return 0;
+    }
+    return probeReads(curOperation.transactionId, siteIds, siteVars,
+                      lockHolders);
+}
+
+bool TransactionManager::canGrant(const Operation &curOperation) {
+    if (isBatch(curOperation)) {
+        vector<int> lockHolders;
+        return !batchConflict(curOperation, lockHolders);
+    }
+    bool isWrite = curOperation.action == Action::WRITE;
+    const auto &siteIds = topology.sitesOf(curOperation.varIdx);
+    vector<Access> access(siteIds.size());
+    sitePool.forEach(siteIds, [&](Site &site, size_t i) {
+        access[i] = isWrite ? site.probeWrite(curOperation.transactionId,
+                                              curOperation.varIdx)
+                            : site.probeRead(curOperation.transactionId,
+                                             curOperation.varIdx);
+    });
+    if (isWrite) {
+        return find(access.begin(), access.end(), Access::BLOCKED) ==
+               access.end();
+    }
+    if (replicaSelector.getPolicy() == ReadPolicy::FIRST_AVAILABLE) {
+        // a read is served by the first available site
+        for (const auto &a : access) {
+            if (a != Access::UNAVAILABLE) {
+                return a == Access::GRANTED;
+            }
+        }
+        return true;
+    }
+    // other policies may send the retried read to any replica
+    return find(access.begin(), access.end(), Access::GRANTED) !=
+               access.end() ||
+           find(access.begin(), access.end(), Access::BLOCKED) == access.end();
+}
+
+void TransactionManager::wakeWaiters(const vector<int> &vars) {
+    vector<Operation> woken;
+    for (const auto &var : vars) {
+        auto queue = waitQueues.find(var);
+        if (queue == waitQueues.end()) {
+            continue;
+        }
+        // woken reads share the lock and a woken write takes it alone; a
+        // request that conflicts with one woken before it keeps waiting,
+        // now on that transaction
+        // the requests that stay are compacted towards the front in one pass
+        auto &waiters = queue->second;
+        auto kept = waiters.begin();
+        auto keep = [&](RingQueue<Operation>::iterator o) {
+            if (o != kept) {
+                *kept = move(*o);
+            }
+            kept++;
+        };
+        vector<int> wokenReaders;
+        int wokenWriter = -1;
+        vector<pair<Index, Operation>> moved;
+        for (auto o = waiters.begin(); o != waiters.end(); o++) {
+            if (isBatch(*o)) {
+                // the request may now wait for a lock on another of its
+                // variables, whose release has to wake it instead
+                vector<int> lockHolders;
+                Index conflict = batchConflict(*o, lockHolders);
+                if (conflict && conflict != var) {
+                    for (const auto &holder : lockHolders) {
+                        addWait(holder, o->transactionId);
+                    }
+                    moved.emplace_back(conflict, move(*o));
+                    continue;
+                }
+            }
+            bool isWrite = writes(*o);
+            vector<int> blockers;
+            if (wokenWriter != -1) {
+                blockers.push_back(wokenWriter);
+            } else if (isWrite) {
+                blockers = wokenReaders;
+            }
+            if (!canGrant(*o)) {
+                keep(o);
+                continue;
+            }
+            if (!blockers.empty()) {
+                for (const auto &holder : blockers) {
+                    addWait(holder, o->transactionId);
+                }
+                keep(o);
+                continue;
+            }
+            if (isWrite) {
+                wokenWriter = o->transactionId;
+            } else {
+                wokenReaders.push_back(o->transactionId);
+            }
+            if (traceEvents) {
+                traceEvents->instant(time, TraceEventWriter::transactions,
+                                     o->transactionId, "woken");
+            }
+            waitingOn.erase(o->transactionId);
+            wokenOn[o->transactionId].push_back(var);
+            woken.push_back(move(*o));
+        }
+        waiters.erase(kept, waiters.end());
+        for (const auto &[conflict, o] : moved) {
+            waitQueues[conflict].push_back(o);
+            waitingOn[o.transactionId] = conflict;
+        }
     }
-    cout << endl;
 
-    cout << "Wait for graph: " << endl;
-    for (const auto &[id, waits] : waitForGraph) {
-        cout << "TransId: " << id << ": ";
-        for (const auto &w : waits) {
-            cout << w << " ";
+    // oldest request first, each followed by what its transaction issued
+    // while it waited
+    stable_sort(woken.begin(), woken.end(),
+                [](const Operation &a, const Operation &b) {
+                    return a.timeStamp < b.timeStamp;
+                });
+    for (auto i = woken.rbegin(); i != woken.rend(); i++) {
+        auto deferred = deferredOperations.find(i->transactionId);
+        if (deferred != deferredOperations.end()) {
+            for (auto j = deferred->second.rbegin();
+                 j != deferred->second.rend(); j++) {
+                operations.push_front(*j);
+            }
+            deferredOperations.erase(deferred);
+        }
+        operations.push_front(*i);
+    }
+}
+
+bool TransactionManager::isValidSite(const int siteId) const {
+    if (siteId < 1 || siteId > topology.siteCount()) {
+        output().line() << "Error: site " << siteId << " does not exist.";
+        return false;
+    }
+    return true;
+}
+
+void TransactionManager::dumpDebug() {
+    output().line();
+    {
+        auto line = output().line();
+        line << "Blocked Transactions: ";
+        for (const auto &[var, waiters] : waitQueues) {
+            for (const auto &o : waiters) {
+                line << o << " ";
+            }
         }
-        cout << endl;
     }
+
+    waitForGraph.dump();
+}
+
+void TransactionManager::writeMetrics(ostream &os) {
+    vector<SiteMetrics> sites(sitePool.size());
+    sitePool.forAll([&](Site &site) {
+        auto siteMetrics = site.metrics();
+        sites[siteMetrics.siteId - 1] = siteMetrics;
+    });
+    metrics.writeJson(os, time, sites);
+}
+
+void TransactionManager::printMetrics() {
+    ostringstream json;
+    writeMetrics(json);
+    output().line() << json.str();
 }
 
 void TransactionManager::dump() {
-    for (const auto &site : sites) {
-        site.dump();
+    for (int siteId = 1; siteId <= sitePool.size(); siteId++) {
+        sitePool.call(siteId, [](Site &site) { site.dump(); });
     }
 
 #ifdef DEBUG
@@ -465,13 +1698,68 @@ void TransactionManager::dump() {
     return;
 }
 
-void TransactionManager::copyCommitedValue(Transaction &transaction) {
-    for (const auto &site : sites) {
-        for (const auto &e : site.commitedVal) {
-            if (site.restrictedReadVariable.count(e.first)) {
-                continue;
-            }
-            transaction.commitedValCopy[e.first] = e.second;
+bool TransactionManager::readSnapshot(const Index idx, const int snapshotTime,
+                                      Value &val) {
+    for (const auto &siteId : topology.sitesOf(idx)) {
+        if (sitePool.call(siteId, [&](Site &site) {
+                return site.readVersion(idx, snapshotTime, val);
+            })) {
+            return true;
         }
     }
-}
\ No newline at end of file
+    return false;
+}
+
+int TransactionManager::versionHorizon() const {
+    return activeSnapshots.empty() ? time : *activeSnapshots.begin();
+}
+
+void TransactionManager::retire(const int transactionId) {
+    auto it = idToTransaction.find(transactionId);
+    if (it == idToTransaction.end()) {
+        return;
+    }
+    const auto &transaction = it->second;
+    // only the anti-dependency checks of Engine::SERIALIZABLE_SNAPSHOT look
+    // at a committed transaction after it ends
+    if (options.engine == Engine::SERIALIZABLE_SNAPSHOT) {
+        tombstones[transactionId] = {transaction.transactionStatus,
+                                     transaction.commitTime,
+                                     transaction.inConflict,
+                                     transaction.outConflict};
+        commitOrder.emplace_back(transaction.commitTime, transactionId);
+    }
+    Arena *arena = transaction.arena;
+    idToTransaction.erase(it);
+    arenas.release(arena);
+
+    // a transaction validating later has a snapshot at or after the
+    // horizon, so only commits after it can be concurrent with it
+    int horizon = versionHorizon();
+    while (!commitOrder.empty() && commitOrder.front().first <= horizon) {
+        auto tombstone = tombstones.find(commitOrder.front().second);
+        if (tombstone != tombstones.end() &&
+            tombstone->second.transactionStatus ==
+                TransactionStatus::COMMITED &&
+            tombstone->second.commitTime == commitOrder.front().first) {
+            tombstones.erase(tombstone);
+        }
+        commitOrder.pop_front();
+    }
+}
+
+void TransactionManager::releaseSnapshot(Transaction &transaction) {
+    if (transaction.snapshotTime < 0) {
+        return;
+    }
+    bool wasOldest = transaction.snapshotTime == *activeSnapshots.begin();
+    activeSnapshots.erase(activeSnapshots.find(transaction.snapshotTime));
+    transaction.snapshotTime = -1;
+    if (!wasOldest) {
+        return;
+    }
+    // versions only the finished snapshot could see are garbage now
+    broadcast([horizon = versionHorizon()](Site &site) {
+        site.collectVersions(horizon);
+    });
+}
@@ -1,12 +1,46 @@
 #pragma once
 
+#include <deque>
 #include <list>
+#include <memory>
+#include <ostream>
+#include <set>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "arena.hpp"
+#include "metrics.hpp"
 #include "operation.hpp"
+#include "operationReader.hpp"
+#include "options.hpp"
+#include "replicaSelector.hpp"
+#include "ringQueue.hpp"
 #include "site.hpp"
+#include "sitePool.hpp"
+#include "topology.hpp"
+#include "traceEvents.hpp"
 #include "transaction.hpp"
+#include "waitForGraph.hpp"
+
+// Counters of one simulation run.
+struct Stats {
+    long long operations = 0;
+    long long commits = 0;
+    // transactions ended by abort, counted at their end()
+    long long aborts = 0;
+    long long deadlocks = 0;
+    // reads and writes that had to wait for a lock
+    long long blocked = 0;
+    // searches of the wait-for graph and the time they took
+    long long deadlockSearches = 0;
+    long long deadlockSearchNs = 0;
+    // transactions buffering their writes aborted at commit by a
+    // conflicting commit
+    long long validationFailures = 0;
+    // reads granted by each site, site i at index i - 1
+    std::vector<long long> siteReads;
+};
 
 class TransactionManager {
    private:
@@ -14,29 +48,190 @@ class TransactionManager {
     // for recovery
     std::unordered_map<int, int> uncommitedVariable;
     int time;
+    // latest time any site failed
+    int lastFailedTime;
 
-    std::list<Operation> operations;
+    // operations to run before reading more from `source`: the rest of a
+    // preloaded trace and blocked operations that are retried
+    RingQueue<Operation> operations;
+    OperationReader *source = nullptr;
+    // backs the containers of each transaction until it ends; declared
+    // before `idToTransaction` so it outlives them
+    ArenaPool arenas;
+    // transactions from their begin() until they commit or abort
     std::unordered_map<int, Transaction> idToTransaction;
-    std::list<Operation> blockedOperations;
-    // a list of Operation that are blocked due to sites fail
-    std::list<Operation> siteFailedOperations;
-    std::unordered_map<int, std::list<int>> waitForGraph;
-    std::vector<Site> sites;
+    // what is left of the transactions that ended
+    std::unordered_map<int, Tombstone> tombstones;
+    // committed tombstones as (commit time, transaction), oldest first
+    std::deque<std::pair<int, int>> commitOrder;
+    // reads and writes blocked on each variable, oldest first; a queue that
+    // drains is kept with its buffer for the next requests blocked there
+    std::unordered_map<int, RingQueue<Operation>> waitQueues;
+    // the variable each waiting transaction is queued on
+    std::unordered_map<int, int> waitingOn;
+    // variables whose queues the transaction was woken from
+    std::unordered_map<int, std::vector<int>> wokenOn;
+    // operations a waiting transaction issued after its blocked one
+    std::unordered_map<int, std::vector<Operation>> deferredOperations;
+    // time each waiting transaction first had its request queued
+    std::unordered_map<int, int> blockedSince;
+    // transactions wait-die or wound-wait chose to abort, each with the
+    // transaction it conflicted with; aborted once the current operation is
+    // done
+    std::vector<std::pair<int, int>> victims;
+    // reads and writes since the last deadlock search
+    int sinceDeadlockSearch = 0;
+    // engines buffering writes: commit time of the latest write of each
+    // variable, absent while it still has its initial value
+    std::unordered_map<int, int> lastCommitTime;
+    // Engine::SERIALIZABLE_SNAPSHOT: the transactions that read each
+    // variable, and the commits that wrote it as (commit time, transaction),
+    // kept while an active transaction may be concurrent with them
+    std::unordered_map<int, std::vector<int>> snapshotReaders;
+    std::unordered_map<int, std::deque<std::pair<int, int>>> snapshotWriters;
+    // operations that are blocked due to sites fail, in trace order
+    std::vector<Operation> siteFailedOperations;
+    WaitForGraph waitForGraph;
+    Topology topology;
+    Options options;
+    SitePool sitePool;
+    ReplicaSelector replicaSelector;
+    Stats stats;
+    Metrics metrics;
+    // null unless options.traceEvents names a file
+    std::unique_ptr<TraceEventWriter> traceEvents;
+
+    // start times of the active read-only transactions
+    std::multiset<int> activeSnapshots;
+
+    // for read-only transactions, the value from the first site serving it
+    bool readSnapshot(const Index idx, const int snapshotTime, Value &val);
+    // versions commited before this time may be dropped
+    int versionHorizon() const;
+    void releaseSnapshot(Transaction &transaction);
+    // replaces a committed transaction by its tombstone under
+    // Engine::SERIALIZABLE_SNAPSHOT, and drops the tombstones no running
+    // transaction can be concurrent with anymore
+    void retire(const int transactionId);
+    // whether the transaction began and has not ended or been doomed
+    bool isRunning(const int transactionId) const;
 
-    // for read-only transactions
-    void copyCommitedValue(Transaction &transaction);
+    bool isValidSite(const int siteId) const;
+    // the write took effect on `siteIds`, or is buffered for them
+    void written(const int curId, const Index idx, const Value val,
+                 const std::vector<int> &siteIds);
+    // read-write transactions read their snapshot
+    bool snapshotIsolation() const;
+    // writes into the transaction's buffer, installed when it commits
+    void bufferWrite(const Operation &curOperation);
+    // remembers what a transaction buffering its writes read, for validate()
+    void noteRead(const int transactionId, const Index idx);
+    // scans and batches: their variables, ascending
+    std::vector<Index> requestedVariables(const Operation &curOperation) const;
+    // "x1, x3" for the variables of a batch
+    static std::string variableList(const Operation &curOperation);
+    std::vector<int> allSites() const;
+    // reads `vars` and prints them as `done`; `what` names the request in
+    // the messages saying why it did not run
+    void readMany(const Operation &curOperation, const std::string &what,
+                  const std::string &done);
+    // splits a read of `vars` among the sites, each variable going to the
+    // first available site in id order; false if one has no such site
+    bool assignReads(const std::vector<Index> &vars, std::vector<int> &siteIds,
+                     std::vector<std::vector<Index>> &siteVars);
+    // one request per site: the first variable a lock conflicts on, 0 if
+    // none, and the transactions holding those locks
+    Index probeReads(const int transactionId, const std::vector<int> &siteIds,
+                     const std::vector<std::vector<Index>> &siteVars,
+                     std::vector<int> &lockHolders);
+    // also fills in the sites a batch write goes to, with their variables
+    Index probeWrites(const Operation &curOperation, std::vector<int> &siteIds,
+                      std::vector<std::vector<Index>> &siteVars,
+                      std::vector<int> &lockHolders);
+    static Index mergeConflicts(const std::vector<Index> &conflicts,
+                                const std::vector<std::vector<int>> &holders,
+                                std::vector<int> &lockHolders);
+    // whether a transaction buffering its writes may commit, reports why not
+    bool validate(Transaction &transaction);
+    // Engine::SERIALIZABLE_SNAPSHOT part of validate()
+    bool checkAntiDependencies(Transaction &transaction);
+    // drops the readers and writers of the variables the transaction touched
+    // that no active transaction is concurrent with anymore
+    void pruneConflictHistory(const Transaction &transaction);
+    // `waiter` has to wait until `holder` ends; under wait-die or wound-wait
+    // one of them may become a victim instead
+    void addWait(const int holder, const int waiter);
+    // whether a transaction has not ended yet, including one a site failure
+    // doomed to abort at its end()
+    bool isLive(const int transactionId) const;
+    void abortVictims();
+    bool periodicDetection() const;
+    // searches for deadlocks when `options` says it is time, or for all of
+    // them when `force` is set; returns whether any was found
+    bool maybeDetectDeadlocks(const bool force);
+    // records the latency of an operation that just took effect
+    void completed(const Operation &curOperation);
+    // a transaction waiting on a lock runs nothing else until its blocked
+    // operation is retried; returns true if `curOperation` was held back
+    bool deferIfBlocked(const Operation &curOperation);
+    // `blockers` hold the locks the request conflicts with; it waits in the
+    // queue of `varIdx`
+    void block(const Operation &curOperation, const std::vector<int> &blockers,
+               const int varIdx);
+    // a granted request waits for nobody; the conflicting requests queued on
+    // its variable now wait for it
+    void granted(const Operation &curOperation);
+    // edges from the transaction to the conflicting requests queued on the
+    // variables it now holds
+    void addQueueEdges(const Operation &curOperation);
+    // variables the transaction may hold locks on or be waited on for;
+    // called once when it commits or aborts
+    std::vector<int> lockedVariables(const int transactionId);
+    // probeReads() or probeWrites() for a blocked scan or batch
+    Index batchConflict(const Operation &curOperation,
+                        std::vector<int> &lockHolders);
+    // whether a blocked request would get its locks now
+    bool canGrant(const Operation &curOperation);
+    // requeues, oldest first, the requests on `vars` that can now be
+    // granted, each followed by the operations deferred behind it
+    void wakeWaiters(const std::vector<int> &vars);
+    // sends a request to every site; waits for the replies unless
+    // commits and aborts are pipelined
+    template <typename F>
+    void broadcast(const F &fn);
 
     // for debugging
     void dumpDebug();
 
    public:
     TransactionManager();
-    TransactionManager(const std::list<Operation> operations);
+    TransactionManager(std::list<Operation> operations,
+                       const Topology topology = Topology(),
+                       const Options options = Options());
+    // streams the trace from `source` while simulating
+    TransactionManager(OperationReader &source,
+                       const Topology topology = Topology(),
+                       const Options options = Options());
 
     void simulate();
-    void detectDeadLock();
+    const Stats &getStats() const { return stats; }
+    // the metrics of the run so far as one JSON object
+    void writeMetrics(std::ostream &os);
+    // stats() in the trace: prints the metrics
+    void printMetrics();
+    // next operation to run, blocked operations first
+    bool nextOperation(Operation &operation);
+    // aborts the youngest transaction of one cycle; returns whether there
+    // was one
+    bool detectDeadLock();
+    // aborts the youngest transaction of every deadlocked component
+    bool detectDeadLocks();
+    void breakDeadLock(const std::vector<int> &pool);
     void begin(const Operation &curOperation, bool isReadOnly);
     void read(const Operation &curOperation);
+    void scan(const Operation &curOperation);
+    void readBatch(const Operation &curOperation);
+    void writeBatch(const Operation &curOperation);
     void write(const Operation &curOperation);
     void commit(const Operation &curOperation);
     void fail(const Operation &curOperation);
@@ -0,0 +1,37 @@
+#include "versionChain.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+bool before(const int time, const Version &version) {
+    return time < version.commitTime;
+}
+}  // namespace
+
+const Version *VersionChain::at(const int time) const {
+    if (current.commitTime <= time) {
+        return &current;
+    }
+    auto it = upper_bound(history.begin(), history.end(), time, before);
+    return it == history.begin() ? nullptr : &*prev(it);
+}
+
+void VersionChain::append(const Version version) {
+    history.push_back(current);
+    current = version;
+}
+
+bool VersionChain::collect(const int horizon) {
+    if (current.commitTime <= horizon) {
+        history.clear();
+        return false;
+    }
+    // keep the version visible at `horizon` and everything after it
+    auto it = upper_bound(history.begin(), history.end(), horizon, before);
+    if (it != history.begin()) {
+        history.erase(history.begin(), prev(it));
+    }
+    return !history.empty();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+using Index = int;
+using Value = int;
+
+// A committed value of a variable, valid from `commitTime` until the next
+// version. `readable` is false while a recovered replica waits for its first
+// commit.
+struct Version {
+    int commitTime;
+    Value value;
+    bool readable;
+};
+
+// Committed versions of one variable on one site. The newest version is kept
+// inline, so a variable that no read-only transaction still needs costs no
+// allocation.
+class VersionChain {
+   private:
+    Version current;
+    // older versions, ascending by commit time
+    std::vector<Version> history;
+
+   public:
+    VersionChain() : current{0, 0, true} {}
+    VersionChain(const Version version) : current(version) {}
+
+    const Version &latest() const { return current; }
+    // the version visible to a snapshot taken at `time`, nullptr if none
+    const Version *at(const int time) const;
+    void append(const Version version);
+    // drop versions no snapshot at or after `horizon` can see; returns
+    // whether older versions are still kept
+    bool collect(const int horizon);
+    size_t size() const { return history.size() + 1; }
+};
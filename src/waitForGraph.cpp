@@ -0,0 +1,215 @@
+#include "waitForGraph.hpp"
+
+#include <algorithm>
+
+#include "output.hpp"
+
+using namespace std;
+
+namespace {
+const list<int> noWaiters;
+const unordered_set<int> noEdges;
+}  // namespace
+
+void WaitForGraph::addEdge(const int holder, const int waiter) {
+    if (outEdges[holder].insert(waiter).second) {
+        waiters[holder].push_back(waiter);
+        inEdges[waiter].insert(holder);
+        pendingEdges.emplace_back(holder, waiter);
+    }
+}
+
+const list<int>& WaitForGraph::waitersOf(const int holder) const {
+    auto it = waiters.find(holder);
+    return it == waiters.end() ? noWaiters : it->second;
+}
+
+void WaitForGraph::removeWaitersOf(const int holder) {
+    waiters.erase(holder);
+    auto it = outEdges.find(holder);
+    if (it == outEdges.end()) {
+        return;
+    }
+    for (const auto& waiter : it->second) {
+        auto in = inEdges.find(waiter);
+        in->second.erase(holder);
+        if (in->second.empty()) {
+            inEdges.erase(in);
+        }
+    }
+    outEdges.erase(it);
+}
+
+void WaitForGraph::removeTransaction(const int transactionId) {
+    removeWaitersOf(transactionId);
+    removeWaitsOf(transactionId);
+}
+
+void WaitForGraph::removeWaitsOf(const int transactionId) {
+    auto it = inEdges.find(transactionId);
+    if (it == inEdges.end()) {
+        return;
+    }
+    for (const auto& holder : it->second) {
+        auto out = outEdges.find(holder);
+        out->second.erase(transactionId);
+        if (out->second.empty()) {
+            outEdges.erase(out);
+        }
+        auto w = waiters.find(holder);
+        w->second.remove(transactionId);
+        if (w->second.empty()) {
+            waiters.erase(w);
+        }
+    }
+    inEdges.erase(it);
+}
+
+bool WaitForGraph::hasEdge(const int holder, const int waiter) const {
+    auto it = outEdges.find(holder);
+    return it != outEdges.end() && it->second.count(waiter);
+}
+
+bool WaitForGraph::findPath(const int from, const int to,
+                            vector<int>& path) const {
+    // iterative DFS, `parent` doubles as the visited set
+    unordered_map<int, int> parent;
+    vector<int> stack{from};
+    parent[from] = from;
+    while (!stack.empty()) {
+        int cur = stack.back();
+        stack.pop_back();
+        if (cur == to) {
+            for (int n = to; n != from; n = parent[n]) {
+                path.push_back(n);
+            }
+            path.push_back(from);
+            return true;
+        }
+        auto it = outEdges.find(cur);
+        if (it == outEdges.end()) {
+            continue;
+        }
+        for (const auto& next : it->second) {
+            if (parent.emplace(next, cur).second) {
+                stack.push_back(next);
+            }
+        }
+    }
+    return false;
+}
+
+bool WaitForGraph::findCycle(vector<int>& cycle) {
+    while (!pendingEdges.empty()) {
+        auto [holder, waiter] = pendingEdges.front();
+        if (!hasEdge(holder, waiter)) {
+            pendingEdges.pop_front();
+            continue;
+        }
+        // the edge closes a cycle iff the waiter already reaches the holder
+        vector<int> path;
+        if (findPath(waiter, holder, path)) {
+            cycle.assign(path.rbegin(), path.rend());
+            return true;
+        }
+        pendingEdges.pop_front();
+    }
+    return false;
+}
+
+bool WaitForGraph::findCycles(vector<vector<int>>& components) {
+    // iterative Tarjan
+    struct Visit {
+        int index, low;
+        bool onStack;
+    };
+    struct Frame {
+        int node;
+        unordered_set<int>::const_iterator next, end;
+    };
+    unordered_map<int, Visit> order;
+    vector<int> stack;
+    vector<Frame> frames;
+    int index = 0;
+    auto visit = [&](const int node) {
+        order[node] = {index, index, true};
+        index++;
+        stack.push_back(node);
+        auto it = outEdges.find(node);
+        const auto& edges = it == outEdges.end() ? noEdges : it->second;
+        frames.push_back({node, edges.begin(), edges.end()});
+    };
+    for (const auto& [holder, waiter] : pendingEdges) {
+        if (!hasEdge(holder, waiter) || order.count(waiter)) {
+            continue;
+        }
+        visit(waiter);
+        while (!frames.empty()) {
+            Frame& frame = frames.back();
+            int node = frame.node;
+            if (frame.next != frame.end) {
+                int next = *frame.next++;
+                auto seen = order.find(next);
+                if (seen == order.end()) {
+                    visit(next);
+                } else if (seen->second.onStack) {
+                    auto& low = order[node].low;
+                    low = min(low, seen->second.index);
+                }
+                continue;
+            }
+            frames.pop_back();
+            const Visit& done = order[node];
+            if (!frames.empty()) {
+                auto& low = order[frames.back().node].low;
+                low = min(low, done.low);
+            }
+            if (done.index != done.low) {
+                continue;
+            }
+            vector<int> component;
+            int member;
+            do {
+                member = stack.back();
+                stack.pop_back();
+                order[member].onStack = false;
+                component.push_back(member);
+            } while (member != node);
+            if (component.size() > 1) {
+                components.push_back(move(component));
+            }
+        }
+    }
+    unordered_map<int, size_t> componentOf;
+    for (size_t i = 0; i < components.size(); i++) {
+        for (const auto& id : components[i]) {
+            componentOf[id] = i;
+        }
+    }
+    deque<pair<int, int>> cyclic;
+    for (const auto& [holder, waiter] : pendingEdges) {
+        auto from = componentOf.find(holder);
+        auto to = componentOf.find(waiter);
+        if (from != componentOf.end() && to != componentOf.end() &&
+            from->second == to->second && hasEdge(holder, waiter)) {
+            cyclic.emplace_back(holder, waiter);
+        }
+    }
+    pendingEdges.swap(cyclic);
+    return !components.empty();
+}
+
+bool WaitForGraph::empty() const { return outEdges.empty(); }
+
+size_t WaitForGraph::size() const { return waiters.size(); }
+
+void WaitForGraph::dump() const {
+    output().line() << "Wait for graph: ";
+    for (const auto& [id, waits] : waiters) {
+        auto line = output().line();
+        line << "TransId: " << id << ": ";
+        for (const auto& w : waits) {
+            line << w << " ";
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// Wait-for graph with edges from a lock holder to the transactions waiting
+// on it. Cycles are detected incrementally: any cycle has to contain an edge
+// added after the last check, so only those pending edges are searched.
+class WaitForGraph {
+   private:
+    // holder -> waiters, in the order the waits started
+    std::unordered_map<int, std::list<int>> waiters;
+    // adjacency used for searching and edge removal
+    std::unordered_map<int, std::unordered_set<int>> outEdges;
+    std::unordered_map<int, std::unordered_set<int>> inEdges;
+    // (holder, waiter) edges that may still close a cycle
+    std::deque<std::pair<int, int>> pendingEdges;
+
+    bool hasEdge(const int holder, const int waiter) const;
+    bool findPath(const int from, const int to, std::vector<int>& path) const;
+
+   public:
+    void addEdge(const int holder, const int waiter);
+    const std::list<int>& waitersOf(const int holder) const;
+    // drop the edges of a finished lock holder
+    void removeWaitersOf(const int holder);
+    // drop the edges into a transaction that got its lock
+    void removeWaitsOf(const int transactionId);
+    // drop every edge that touches the transaction
+    void removeTransaction(const int transactionId);
+
+    // returns one cycle reachable from the pending edges; the edge that
+    // closed it stays pending until it is removed or proven acyclic
+    bool findCycle(std::vector<int>& cycle);
+    // one pass over everything the pending edges reach: returns the
+    // strongly connected components with more than one transaction, each
+    // holding at least one cycle; only their edges stay pending
+    bool findCycles(std::vector<std::vector<int>>& components);
+    bool empty() const;
+    size_t size() const;
+    void dump() const;
+};